@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+//Tiny benchmark registry - each benchmark runs its workload once per call and
+//reports how many items/bytes it processed, the runner handles repeats & timing
+namespace bench {
+    class Context {
+        public:
+        double items = 0;
+        double bytes = 0;
+        //Extra per run figures printed after the timings, ie: allocations
+        std::vector<std::pair<std::string, double>> counters;
+
+        void processed(double items, double bytes = 0) {
+            this->items = items;
+            this->bytes = bytes;
+        }
+
+        void counter(std::string name, double value) {
+            for (auto& c : counters) {
+                if (c.first == name) {
+                    c.second = value;
+                    return;
+                }
+            }
+            counters.push_back({name, value});
+        }
+    };
+
+    //Number of operator new calls so far in this process (counted by the runner)
+    size_t allocations();
+
+    struct Benchmark {
+        std::string name;
+        std::function<void(Context&)> fn;
+    };
+
+    inline std::vector<Benchmark>& registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Register {
+        Register(std::string name, std::function<void(Context&)> fn) {
+            registry().push_back(Benchmark{name, fn});
+        }
+    };
+
+    //Stops the optimiser discarding a result
+    template<typename T> inline void keep(T const& val) {
+        asm volatile("" : : "r,m"(val) : "memory");
+    }
+}
+
+#define BENCHMARK(fn) static bench::Register fn##_registered(#fn, fn);
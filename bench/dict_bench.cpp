@@ -0,0 +1,92 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "bench.hpp"
+#include "../src/dict.hpp"
+
+//Dictionary table vs std::unordered_map with the same keys & values, 1e6 entries
+
+static const int ENTRIES = 1000000;
+
+static std::vector<DictKey>& keys() {
+    static std::vector<DictKey> k;
+    if (k.empty()) {
+        for (int x = 0; x < ENTRIES; x++) {
+            k.push_back(DictKey("key" + std::to_string(x)));
+        }
+    }
+    return k;
+}
+
+static SwissMap<DictKey, std::any, DictKeyHash>& filledSwiss() {
+    static SwissMap<DictKey, std::any, DictKeyHash> m;
+    if (m.size() == 0) {
+        for (auto& k : keys()) m.set(k, 1.0);
+    }
+    return m;
+}
+
+static std::unordered_map<std::string, std::any>& filledStd() {
+    static std::unordered_map<std::string, std::any> m;
+    if (m.empty()) {
+        for (auto& k : keys()) m[k.str] = 1.0;
+    }
+    return m;
+}
+
+static void dictInsert(bench::Context& ctx) {
+    auto& k = keys();
+    SwissMap<DictKey, std::any, DictKeyHash> m;
+    for (int x = 0; x < ENTRIES; x++) m.set(k[x], (double)x);
+    bench::keep(m.size());
+    ctx.processed(ENTRIES);
+}
+BENCHMARK(dictInsert)
+
+static void stdMapInsert(bench::Context& ctx) {
+    auto& k = keys();
+    std::unordered_map<std::string, std::any> m;
+    for (int x = 0; x < ENTRIES; x++) m[k[x].str] = (double)x;
+    bench::keep(m.size());
+    ctx.processed(ENTRIES);
+}
+BENCHMARK(stdMapInsert)
+
+static void dictLookup(bench::Context& ctx) {
+    auto& k = keys();
+    auto& m = filledSwiss();
+    size_t found = 0;
+    //Strided so consecutive lookups don't share cache lines
+    for (int x = 0; x < ENTRIES; x++) found += m.get(k[(x * 7919L) % ENTRIES]) != nullptr;
+    bench::keep(found);
+    ctx.processed(ENTRIES);
+}
+BENCHMARK(dictLookup)
+
+static void stdMapLookup(bench::Context& ctx) {
+    auto& k = keys();
+    auto& m = filledStd();
+    size_t found = 0;
+    for (int x = 0; x < ENTRIES; x++) found += m.find(k[(x * 7919L) % ENTRIES].str) != m.end();
+    bench::keep(found);
+    ctx.processed(ENTRIES);
+}
+BENCHMARK(stdMapLookup)
+
+static void dictIterate(bench::Context& ctx) {
+    auto& m = filledSwiss();
+    size_t n = 0;
+    m.each([&](const DictKey& k, std::any& v) { n += k.hash; });
+    bench::keep(n);
+    ctx.processed(ENTRIES);
+}
+BENCHMARK(dictIterate)
+
+static void stdMapIterate(bench::Context& ctx) {
+    auto& m = filledStd();
+    size_t n = 0;
+    for (auto& e : m) n += e.first.size();
+    bench::keep(n);
+    ctx.processed(ENTRIES);
+}
+BENCHMARK(stdMapIterate)
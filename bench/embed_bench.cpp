@@ -0,0 +1,77 @@
+#include <string>
+#include "bench.hpp"
+#include "../src/embed.hpp"
+#include "../src/interpreter.hpp"
+
+//Per call cost of the embedding API against running a whole source through lrun() each time
+//(what an embedder had to do before). 1e9 / items/s is the cost of one call in ns.
+
+static const std::string SOURCE = R"(
+func add(a, b) {
+    return a + b;
+}
+func callHost(n) {
+    udv total = 0;
+    for (udv i = 0; i < n; i = i + 1) {
+        total = total + host(i);
+    }
+    return total;
+}
+)";
+
+static const int CALLS = 100000;
+
+//Precompiled script, one context, many calls
+static void embedCall(bench::Context& ctx) {
+    static std::shared_ptr<huff::Script> script = huff::Script::compile(SOURCE);
+    huff::Context context(script);
+    context.run();
+
+    size_t before = bench::allocations();
+    HInt total = 0;
+    for (int c = 0; c < CALLS; c++) {
+        total += context.call("add", {c, 1}).value.asInt();
+    }
+    bench::keep(total);
+    ctx.processed(CALLS);
+    ctx.counter("allocs/call", (double)(bench::allocations() - before) / CALLS);
+}
+BENCHMARK(embedCall);
+
+//Script calling back into a host function registered as a native
+static void embedHostNative(bench::Context& ctx) {
+    static std::shared_ptr<huff::Script> script = huff::Script::compile(SOURCE);
+    huff::Context context(script);
+    context.function("host", [](std::vector<huff::Value>& args) {
+        return huff::Value(args[0].asInt() * 2);
+    });
+
+    bench::keep(context.call("callHost", {CALLS}).value.asInt());
+    ctx.processed(CALLS);
+}
+BENCHMARK(embedHostNative);
+
+//A fresh context per evaluation
+static void embedContext(bench::Context& ctx) {
+    static std::shared_ptr<huff::Script> script = huff::Script::compile(SOURCE);
+    const int contexts = 2000;
+    HInt total = 0;
+    for (int c = 0; c < contexts; c++) {
+        huff::Context context(script);
+        total += context.call("add", {c, 1}).value.asInt();
+    }
+    bench::keep(total);
+    ctx.processed(contexts);
+}
+BENCHMARK(embedContext);
+
+//The old way - scan, parse & interpret the source for every evaluation
+static void lrunEval(bench::Context& ctx) {
+    const int evals = 2000;
+    std::string source = SOURCE + "udv result = add(1, 2);\n";
+    for (int e = 0; e < evals; e++) {
+        lrun(source);
+    }
+    ctx.processed(evals);
+}
+BENCHMARK(lrunEval);
@@ -0,0 +1,69 @@
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include "bench.hpp"
+#include "../src/fileio.hpp"
+
+//Line scanning throughput of the file natives against std::getline, on a 1 GB log
+
+static const char* PATH = "/tmp/huffle_bench_1g.log";
+static const size_t SIZE = 1024L * 1024 * 1024;
+
+static void makeLog() {
+    static bool made = false;
+    if (made) return;
+
+    struct stat info;
+    if (stat(PATH, &info) != 0 || (size_t)info.st_size < SIZE) {
+        FILE* f = fopen(PATH, "w");
+        const char* line = "INFO request served in 12ms user=alice path=/api/v1/items\n";
+        size_t lineSize = strlen(line);
+        for (size_t written = 0; written < SIZE; written += lineSize) {
+            fwrite(line, 1, lineSize, f);
+        }
+        fclose(f);
+    }
+    made = true;
+}
+
+static void readLineViews(bench::Context& ctx) {
+    makeLog();
+    HFile f(PATH, "r");
+    size_t lines = 0;
+    size_t bytes = 0;
+    while (!f.eof()) {
+        bytes += f.readLine().size() + 1;
+        lines++;
+    }
+    bench::keep(lines);
+    ctx.processed(lines, bytes);
+}
+BENCHMARK(readLineViews)
+
+static void stdGetline(bench::Context& ctx) {
+    makeLog();
+    std::ifstream f(PATH);
+    std::string line;
+    size_t lines = 0;
+    size_t bytes = 0;
+    while (std::getline(f, line)) {
+        bytes += line.size() + 1;
+        lines++;
+    }
+    bench::keep(lines);
+    ctx.processed(lines, bytes);
+}
+BENCHMARK(stdGetline)
+
+static void readAllMapped(bench::Context& ctx) {
+    makeLog();
+    HFile f(PATH, "r");
+    HString all = f.readAll();
+    //Touch every page so the mapping is actually read
+    size_t sum = 0;
+    std::string_view v = all.view();
+    for (size_t x = 0; x < v.size(); x += 4096) sum += v[x];
+    bench::keep(sum);
+    ctx.processed(1, v.size());
+}
+BENCHMARK(readAllMapped)
@@ -0,0 +1,98 @@
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "generate.hpp"
+#include "../src/scanner.hpp"
+#include "../src/parser.hpp"
+#include "../src/astwalk.hpp"
+
+//Scanner & parser throughput over generated programs of each shape
+//  scan_<shape>  - items are tokens, reports MB/s of source and tokens/s
+//  parse_<shape> - items are AST nodes, tokens are scanned up front
+//Both report the allocations made by their phase alone
+
+static const size_t SOURCE_BYTES = 2 * 1024 * 1024;
+
+//Counts every node reachable from the parsed statements
+class NodeCounter : public AstWalker {
+    public:
+    using AstWalker::walk;
+    size_t nodes = 0;
+
+    void walk(Expr* e) {
+        if (e != nullptr) nodes++;
+        AstWalker::walk(e);
+    }
+
+    void walk(Stmt* s) {
+        if (s != nullptr) nodes++;
+        AstWalker::walk(s);
+    }
+};
+
+static const std::string& source(gen::Shape shape) {
+    static std::string sources[gen::MIXED + 1];
+    if (sources[shape].empty()) {
+        sources[shape] = gen::program(shape, SOURCE_BYTES);
+    }
+    return sources[shape];
+}
+
+static std::vector<Token> scanned(const std::string& src) {
+    std::vector<Token> tokens = Scanner(src).scan();
+    tokens.push_back(Token(EF, "", '\0', 0));
+    return tokens;
+}
+
+static void scanShape(bench::Context& ctx, gen::Shape shape) {
+    const std::string& src = source(shape);
+    size_t before = bench::allocations();
+    std::vector<Token> tokens = Scanner(src).scan();
+    size_t allocs = bench::allocations() - before;
+
+    bench::keep(tokens.size());
+    ctx.processed(tokens.size(), src.size());
+    ctx.counter("allocs", allocs);
+    ctx.counter("allocs/token", (double)allocs / tokens.size());
+}
+
+//Each run parses a fresh copy of the tokens
+static void parseShape(bench::Context& ctx, gen::Shape shape) {
+    const std::string& src = source(shape);
+    std::vector<Token> tokens = scanned(src);
+    size_t count = tokens.size();
+
+    size_t before = bench::allocations();
+    std::vector<Stmt*> stmts = Parser(std::move(tokens)).parse();
+    size_t allocs = bench::allocations() - before;
+
+    NodeCounter counter;
+    counter.walk(stmts);
+    huff::freeAst(stmts);
+    ctx.processed(counter.nodes, src.size());
+    ctx.counter("allocs", allocs);
+    ctx.counter("allocs/token", (double)allocs / count);
+}
+
+static void scanNested(bench::Context& ctx) { scanShape(ctx, gen::NESTED); }
+static void scanFunctions(bench::Context& ctx) { scanShape(ctx, gen::FUNCTIONS); }
+static void scanStrings(bench::Context& ctx) { scanShape(ctx, gen::STRINGS); }
+static void scanComments(bench::Context& ctx) { scanShape(ctx, gen::COMMENTS); }
+static void scanMixed(bench::Context& ctx) { scanShape(ctx, gen::MIXED); }
+
+static void parseNested(bench::Context& ctx) { parseShape(ctx, gen::NESTED); }
+static void parseFunctions(bench::Context& ctx) { parseShape(ctx, gen::FUNCTIONS); }
+static void parseStrings(bench::Context& ctx) { parseShape(ctx, gen::STRINGS); }
+static void parseComments(bench::Context& ctx) { parseShape(ctx, gen::COMMENTS); }
+static void parseMixed(bench::Context& ctx) { parseShape(ctx, gen::MIXED); }
+
+BENCHMARK(scanNested)
+BENCHMARK(scanFunctions)
+BENCHMARK(scanStrings)
+BENCHMARK(scanComments)
+BENCHMARK(scanMixed)
+BENCHMARK(parseNested)
+BENCHMARK(parseFunctions)
+BENCHMARK(parseStrings)
+BENCHMARK(parseComments)
+BENCHMARK(parseMixed)
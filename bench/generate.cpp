@@ -0,0 +1,30 @@
+#include <iostream>
+#include <cstring>
+#include "generate.hpp"
+
+//Writes a synthetic Huffle program to stdout
+//  huffle_gen [--shape=nested|functions|strings|comments|mixed] [--size=bytes] [--seed=n]
+int main(int argc, char* argv[]) {
+    gen::Shape shape = gen::MIXED;
+    size_t size = 1024 * 1024;
+    unsigned seed = 42;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--shape=", 8) == 0) {
+            if (!gen::parseShape(argv[i] + 8, shape)) {
+                std::cerr << "Unknown shape: " << argv[i] + 8 << std::endl;
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--size=", 7) == 0) {
+            size = std::stoul(argv[i] + 7);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = std::stoul(argv[i] + 7);
+        } else {
+            std::cerr << "Usage: huffle_gen [--shape=nested|functions|strings|comments|mixed] [--size=bytes] [--seed=n]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << gen::program(shape, size, seed);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <random>
+
+//Synthetic Huffle programs for front end benchmarks
+//Every shape produces a valid program of roughly `bytes` bytes
+namespace gen {
+    enum Shape {
+        NESTED,     //deeply nested arithmetic expressions
+        FUNCTIONS,  //many small function declarations & calls
+        STRINGS,    //long string literals
+        COMMENTS,   //mostly comments
+        MIXED       //all of the above, interleaved
+    };
+
+    inline bool parseShape(const std::string& name, Shape& shape) {
+        if (name == "nested") shape = NESTED;
+        else if (name == "functions") shape = FUNCTIONS;
+        else if (name == "strings") shape = STRINGS;
+        else if (name == "comments") shape = COMMENTS;
+        else if (name == "mixed") shape = MIXED;
+        else return false;
+        return true;
+    }
+
+    inline std::string nestedExpr(std::mt19937& rng, int depth) {
+        const char* ops[] = {" + ", " - ", " * "};
+        std::string expr = std::to_string(rng() % 100);
+        for (int d = 0; d < depth; d++) {
+            expr = "(" + expr + ops[rng() % 3] + std::to_string(rng() % 100) + ")";
+        }
+        return expr;
+    }
+
+    inline void appendNested(std::string& out, std::mt19937& rng, int n) {
+        out += "udv n" + std::to_string(n) + " = " + nestedExpr(rng, 40) + ";\n";
+    }
+
+    inline void appendFunction(std::string& out, std::mt19937& rng, int n) {
+        std::string name = "f" + std::to_string(n);
+        out += "func " + name + "(a, b) {\n";
+        out += "  udv c = a * b + " + std::to_string(rng() % 100) + ";\n";
+        out += "  if (c > 10 and a < b) {\n    return c - a;\n  } else {\n    return c + b;\n  }\n}\n";
+        out += "out(" + name + "(" + std::to_string(rng() % 10) + ", " + std::to_string(rng() % 10) + "));\n";
+    }
+
+    inline void appendString(std::string& out, std::mt19937& rng, int n) {
+        std::string lit;
+        while (lit.size() < 400) {
+            lit += "lorem ipsum dolor sit amet ";
+        }
+        out += "udv s" + std::to_string(n) + " = \"" + lit + std::to_string(rng()) + "\";\n";
+    }
+
+    inline void appendComment(std::string& out, std::mt19937& rng, int n) {
+        for (int x = 0; x < 8; x++) {
+            out += "// comment line " + std::to_string(x) + " explaining the next statement in far too much detail\n";
+        }
+        out += "udv c" + std::to_string(n) + " = " + std::to_string(rng() % 1000) + ";\n";
+    }
+
+    inline std::string program(Shape shape, size_t bytes, unsigned seed = 42) {
+        std::mt19937 rng(seed);
+        std::string out;
+        out.reserve(bytes + 1024);
+        for (int n = 0; out.size() < bytes; n++) {
+            Shape next = shape == MIXED ? (Shape)(n % 4) : shape;
+            switch (next) {
+                case NESTED: appendNested(out, rng, n); break;
+                case FUNCTIONS: appendFunction(out, rng, n); break;
+                case STRINGS: appendString(out, rng, n); break;
+                default: appendComment(out, rng, n); break;
+            }
+        }
+        return out;
+    }
+}
@@ -0,0 +1,118 @@
+#include <string>
+#include <string_view>
+#include "bench.hpp"
+#include "../src/visitor.hpp"
+
+//JSON natives on 50 MB of newline delimited records - indexing alone, parsing each record, and
+//pulling three fields out of each (against finding them with string searches, as scripts did)
+
+static const size_t INPUT = 50 * 1024 * 1024;
+
+static const std::string& records() {
+    static std::string text;
+    if (text.empty()) {
+        const char* names[] = {"alice", "bob", "carol", "dave"};
+        const char* paths[] = {"/api/v1/items", "/api/v1/users", "/health", "/api/v2/search?q=\\\"x\\\""};
+        unsigned seed = 1;
+        for (size_t id = 0; text.size() < INPUT; id++) {
+            seed = seed * 1103515245 + 12345;
+            text += "{\"id\": " + std::to_string(id) + ", \"ts\": 1700000000.25, \"user\": {\"name\": \"" + names[(seed >> 16) % 4]
+                + "\", \"roles\": [\"read\", \"write\"]}, \"request\": {\"method\": \"GET\", \"path\": \"" + paths[(seed >> 18) % 4]
+                + "\", \"status\": " + std::to_string(200 + (seed >> 20) % 4 * 100) + "}, \"ok\": true}\n";
+        }
+    }
+    return text;
+}
+
+template<typename F> static void eachLine(F fn) {
+    std::string_view all = records();
+    for (size_t at = 0; at < all.size();) {
+        size_t end = all.find('\n', at);
+        fn(all.substr(at, end - at));
+        at = end + 1;
+    }
+}
+
+static void jsonIndex(bench::Context& ctx) {
+    //Kept between runs like jsonParse's, so this is the scan rather than page faults
+    static huff::json::Positions positions;
+    positions.size = 0;
+    bench::keep(huff::json::index(records(), positions));
+    ctx.processed(positions.size, records().size());
+}
+BENCHMARK(jsonIndex)
+
+static void jsonParseLines(bench::Context& ctx) {
+    HString all(records());
+    size_t lines = 0;
+    std::string_view view = all.view();
+    for (size_t at = 0; at < view.size(); lines++) {
+        size_t end = view.find('\n', at);
+        JsonDoc doc(all.slice(at, end - at));
+        doc.parse();
+        bench::keep(doc.tape.size());
+        at = end + 1;
+    }
+    ctx.processed(lines, view.size());
+}
+BENCHMARK(jsonParseLines)
+
+//Lookups only, on one parsed record - they shouldn't allocate
+static void jsonGetFields(bench::Context& ctx) {
+    JsonDoc doc(HString(records().substr(0, records().find('\n'))));
+    doc.parse();
+    size_t before = bench::allocations();
+    const size_t N = 1000000;
+    for (size_t n = 0; n < N; n++) {
+        bench::keep(doc.find("user.name"));
+        bench::keep(doc.find("request.status"));
+        bench::keep(doc.find("user.roles.1"));
+    }
+    ctx.counter("allocs", bench::allocations() - before);
+    ctx.processed(3 * N);
+}
+BENCHMARK(jsonGetFields)
+
+//jsonParse then jsonGet of three fields per record, through the natives
+static void jsonExtract(bench::Context& ctx) {
+    Interpreter i;
+    jsonParse parse;
+    jsonGet get;
+    std::any all = HString(records());
+    const HString& text = std::any_cast<HString&>(all);
+    std::any paths[] = {HString("user.name"), HString("request.status"), HString("request.path")};
+    size_t lines = 0;
+    HInt statuses = 0;
+    std::string_view view = text.view();
+    for (size_t at = 0; at < view.size(); lines++) {
+        size_t end = view.find('\n', at);
+        std::any doc = parse.call(&i, {text.slice(at, end - at)});
+        bench::keep(get.call(&i, {doc, paths[0]}));
+        statuses += std::any_cast<HInt>(get.call(&i, {doc, paths[1]}));
+        bench::keep(get.call(&i, {doc, paths[2]}));
+        at = end + 1;
+    }
+    bench::keep(statuses);
+    ctx.processed(lines, view.size());
+}
+BENCHMARK(jsonExtract)
+
+//The same three fields found by searching each line for their keys & copying the values out
+static void searchExtract(bench::Context& ctx) {
+    size_t lines = 0;
+    long statuses = 0;
+    eachLine([&](std::string_view line) {
+        auto field = [&](std::string_view key) {
+            size_t at = line.find(key) + key.size();
+            size_t end = line[at] == '"' ? line.find('"', ++at) : line.find_first_of(",}", at);
+            return std::string(line.substr(at, end - at));
+        };
+        bench::keep(field("\"name\": "));
+        statuses += std::stol(field("\"status\": "));
+        bench::keep(field("\"path\": "));
+        lines++;
+    });
+    bench::keep(statuses);
+    ctx.processed(lines, records().size());
+}
+BENCHMARK(searchExtract)
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include "bench.hpp"
+
+//Every allocation in the process is counted so benchmarks can report allocations per phase
+static std::atomic<size_t> allocCount{0};
+
+size_t bench::allocations() {
+	return allocCount.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size == 0 ? 1 : size)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	free(p);
+}
+
+//Runs every registered benchmark (or those containing --filter=) and prints the median of --repeats= runs
+int main(int argc, char* argv[]) {
+	std::string filter;
+	int repeats = 5;
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--filter=", 9) == 0) {
+			filter = argv[i] + 9;
+		} else if (strncmp(argv[i], "--repeats=", 10) == 0) {
+			repeats = std::max(1, atoi(argv[i] + 10));
+		}
+	}
+
+	printf("%-40s %12s %14s %12s\n", "benchmark", "median ms", "items/s", "MB/s");
+	for (bench::Benchmark& b : bench::registry()) {
+		if (!filter.empty() && b.name.find(filter) == std::string::npos) continue;
+
+		std::vector<double> times;
+		bench::Context ctx;
+		for (int r = 0; r < repeats; r++) {
+			auto start = std::chrono::steady_clock::now();
+			b.fn(ctx);
+			auto end = std::chrono::steady_clock::now();
+			times.push_back(std::chrono::duration<double>(end - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		double median = times[times.size() / 2];
+
+		printf("%-40s %12.3f %14.0f %12.1f", b.name.c_str(), median * 1000, ctx.items / median, ctx.bytes / median / 1e6);
+		for (auto& c : ctx.counters) {
+			printf(c.second == (long)c.second ? "  %s=%.0f" : "  %s=%.3f", c.first.c_str(), c.second);
+		}
+		printf("\n");
+	}
+	return 0;
+}
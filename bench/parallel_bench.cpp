@@ -0,0 +1,44 @@
+#include <string>
+#include <thread>
+#include "bench.hpp"
+#include "../src/interpreter.hpp"
+
+//preduce over 1e7 iterations on 1, 2, 4 ... cores, against the same sum as a plain loop
+//Compare items/s (iterations per second) between the rows for the speedup
+//Slow at the default repeats - run with --filter=Range --repeats=1
+
+static const long ITERATIONS = 10000000;
+
+static const std::string FUNCTIONS = R"(
+func sq(i) { return i * i; }
+func add(a, b) { return a + b; }
+)";
+
+static void loopRange(bench::Context& ctx) {
+    lrun(FUNCTIONS + R"(
+udv total = 0;
+for (udv i = 0; i < )" + std::to_string(ITERATIONS) + R"(; i = i + 1) {
+    total = add(total, sq(i));
+}
+)");
+    ctx.processed(ITERATIONS);
+}
+
+static void preduceRange(bench::Context& ctx, unsigned threads) {
+    setTaskThreads(threads);
+    lrun(FUNCTIONS + "udv total = preduce(sq, 0, " + std::to_string(ITERATIONS) + ", 0, add);\n");
+    ctx.processed(ITERATIONS);
+    ctx.counter("threads", threads);
+}
+
+BENCHMARK(loopRange)
+
+static bool registered = [] {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads *= 2) {
+        threads = std::min(threads, cores);
+        bench::Register("preduceRange/" + std::to_string(threads), [threads](bench::Context& ctx) { preduceRange(ctx, threads); });
+        if (threads == cores) break;
+    }
+    return true;
+}();
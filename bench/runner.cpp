@@ -0,0 +1,184 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+//Runs every bench/*.huff script N times through the interpreter and reports wall time & peak RSS
+//
+//  huffle_bench_runner --huffle=<binary> --dir=<bench dir> [--runs=N]
+//                      [--save=baseline.json] [--baseline=baseline.json]
+//                      [--threshold=0.10] [--rss-threshold=0.20]
+//
+//With --baseline, exits with status 1 if any script's median time (or peak RSS) is
+//worse than the baseline by more than the threshold fraction
+
+struct Result {
+    double medianMs = 0;
+    double p95Ms = 0;
+    double minMs = 0;
+    long peakRssKb = 0;
+};
+
+//Runs one script, returns false if it failed to run
+bool runOnce(const std::string& huffle, const std::string& script, double& ms, long& rssKb) {
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        execl(huffle.c_str(), huffle.c_str(), script.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    if (pid < 0) return false;
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) return false;
+    auto end = std::chrono::steady_clock::now();
+
+    ms = std::chrono::duration<double, std::milli>(end - start).count();
+    rssKb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+double percentile(std::vector<double> sorted, double p) {
+    size_t at = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(at, sorted.size() - 1)];
+}
+
+void save(const std::string& path, const std::map<std::string, Result>& results) {
+    std::ofstream out(path);
+    out << "{\n";
+    size_t n = 0;
+    for (auto& r : results) {
+        char line[512];
+        snprintf(line, sizeof(line), "    \"%s\": {\"median_ms\": %.3f, \"p95_ms\": %.3f, \"min_ms\": %.3f, \"peak_rss_kb\": %ld}%s\n",
+            r.first.c_str(), r.second.medianMs, r.second.p95Ms, r.second.minMs, r.second.peakRssKb, ++n < results.size() ? "," : "");
+        out << line;
+    }
+    out << "}\n";
+}
+
+//Reads a file written by save() - one benchmark per line
+std::map<std::string, Result> load(const std::string& path) {
+    std::map<std::string, Result> results;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        char name[256];
+        Result r;
+        if (sscanf(line.c_str(), " \"%255[^\"]\": {\"median_ms\": %lf, \"p95_ms\": %lf, \"min_ms\": %lf, \"peak_rss_kb\": %ld}",
+                name, &r.medianMs, &r.p95Ms, &r.minMs, &r.peakRssKb) == 5) {
+            results[name] = r;
+        }
+    }
+    return results;
+}
+
+int main(int argc, char* argv[]) {
+    std::string huffle = "./huffle";
+    std::string dir = "bench";
+    std::string savePath;
+    std::string baselinePath;
+    int runs = 5;
+    double threshold = 0.10;
+    double rssThreshold = 0.20;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--huffle") huffle = val;
+        else if (key == "--dir") dir = val;
+        else if (key == "--runs") runs = std::max(1, atoi(val.c_str()));
+        else if (key == "--save") savePath = val;
+        else if (key == "--baseline") baselinePath = val;
+        else if (key == "--threshold") threshold = atof(val.c_str());
+        else if (key == "--rss-threshold") rssThreshold = atof(val.c_str());
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<std::filesystem::path> scripts;
+    for (auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".huff") scripts.push_back(entry.path());
+    }
+    std::sort(scripts.begin(), scripts.end());
+
+    std::map<std::string, Result> results;
+    printf("%-24s %10s %10s %10s %12s\n", "script", "median ms", "p95 ms", "min ms", "peak RSS kB");
+    for (auto& script : scripts) {
+        std::vector<double> times;
+        Result r;
+        for (int x = 0; x < runs; x++) {
+            double ms;
+            long rss;
+            if (!runOnce(huffle, script.string(), ms, rss)) {
+                std::cerr << "Failed to run " << script << " with " << huffle << std::endl;
+                return 2;
+            }
+            times.push_back(ms);
+            r.peakRssKb = std::max(r.peakRssKb, rss);
+        }
+        std::sort(times.begin(), times.end());
+        r.medianMs = percentile(times, 0.5);
+        r.p95Ms = percentile(times, 0.95);
+        r.minMs = times.front();
+
+        std::string name = script.stem().string();
+        results[name] = r;
+        printf("%-24s %10.2f %10.2f %10.2f %12ld\n", name.c_str(), r.medianMs, r.p95Ms, r.minMs, r.peakRssKb);
+    }
+
+    if (!savePath.empty()) {
+        save(savePath, results);
+        std::cout << "Saved baseline to " << savePath << std::endl;
+    }
+
+    if (baselinePath.empty()) return 0;
+
+    std::map<std::string, Result> baseline = load(baselinePath);
+    if (baseline.empty()) {
+        std::cerr << "No baseline results in " << baselinePath << std::endl;
+        return 2;
+    }
+
+    int regressions = 0;
+    for (auto& r : results) {
+        auto found = baseline.find(r.first);
+        if (found == baseline.end()) continue;
+
+        double timeChange = r.second.medianMs / found->second.medianMs - 1;
+        double rssChange = (double)r.second.peakRssKb / found->second.peakRssKb - 1;
+        if (timeChange > threshold) {
+            printf("REGRESSION %s: median %.2f ms -> %.2f ms (%+.1f%%)\n", r.first.c_str(), found->second.medianMs, r.second.medianMs, timeChange * 100);
+            regressions++;
+        }
+        if (rssChange > rssThreshold) {
+            printf("REGRESSION %s: peak RSS %ld kB -> %ld kB (%+.1f%%)\n", r.first.c_str(), found->second.peakRssKb, r.second.peakRssKb, rssChange * 100);
+            regressions++;
+        }
+    }
+
+    if (regressions > 0) {
+        printf("%d regression(s) past the threshold\n", regressions);
+        return 1;
+    }
+    printf("No regressions against %s\n", baselinePath.c_str());
+    return 0;
+}
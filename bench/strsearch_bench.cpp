@@ -0,0 +1,76 @@
+#include <any>
+#include <string>
+#include "bench.hpp"
+#include "../src/strsearch.hpp"
+
+//String search natives on a 100 MB log-like input, needle absent (worst case scan)
+
+static const size_t INPUT = 100 * 1024 * 1024;
+
+static const std::string& haystack() {
+    static std::string hay;
+    if (hay.empty()) {
+        const char* words[] = {"INFO ", "request ", "served ", "in ", "12ms ", "user=", "alice ", "path=/api/v1/items\n"};
+        unsigned seed = 1;
+        while (hay.size() < INPUT) {
+            seed = seed * 1103515245 + 12345;
+            hay += words[(seed >> 16) % 8];
+        }
+    }
+    return hay;
+}
+
+static const std::string needle = "status=503";
+
+//The previous contains(): both strings copied out of std::any, then std::string::find
+static void legacyContains(bench::Context& ctx) {
+    std::any hay = haystack();
+    std::any sub = needle;
+    bool found = std::any_cast<std::string>(hay).find(std::any_cast<std::string>(sub)) != std::string::npos;
+    bench::keep(found);
+    ctx.processed(1, INPUT);
+}
+BENCHMARK(legacyContains)
+
+static void findScalar(bench::Context& ctx) {
+    const std::string& hay = haystack();
+    bench::keep(huff::search::findScalar(hay.data(), hay.size(), needle.data(), needle.size()));
+    ctx.processed(1, INPUT);
+}
+BENCHMARK(findScalar)
+
+static void findSSE2(bench::Context& ctx) {
+#ifdef HUFF_X86
+    const std::string& hay = haystack();
+    bench::keep(huff::search::findSSE2(hay.data(), hay.size(), needle.data(), needle.size()));
+#endif
+    ctx.processed(1, INPUT);
+}
+BENCHMARK(findSSE2)
+
+static void findAVX2(bench::Context& ctx) {
+#ifdef HUFF_X86
+    if (__builtin_cpu_supports("avx2")) {
+        const std::string& hay = haystack();
+        bench::keep(huff::search::findAVX2(hay.data(), hay.size(), needle.data(), needle.size()));
+    }
+#endif
+    ctx.processed(1, INPUT);
+}
+BENCHMARK(findAVX2)
+
+//count() of a frequent word - many candidate hits
+static void countDispatch(bench::Context& ctx) {
+    bench::keep(huff::search::count(haystack(), "alice"));
+    ctx.processed(1, INPUT);
+}
+BENCHMARK(countDispatch)
+
+static void countScalar(bench::Context& ctx) {
+    std::string_view hay = haystack();
+    size_t total = 0;
+    for (size_t at = hay.find("alice"); at != std::string_view::npos; at = hay.find("alice", at + 5)) total++;
+    bench::keep(total);
+    ctx.processed(1, INPUT);
+}
+BENCHMARK(countScalar)
@@ -0,0 +1,41 @@
+#include <string>
+#include <thread>
+#include "bench.hpp"
+#include "../src/interpreter.hpp"
+
+//spawn/await scaling on a CPU bound workload - the same 64 fib(15) tasks on 1, 2, 4 ... cores
+//Compare items/s (tasks per second) between the rows for the speedup
+
+static const int TASKS = 64;
+
+static const std::string SCRIPT = R"(
+func fib(n) {
+    if (n < 2) { return n; }
+    return fib(n - 1) + fib(n - 2);
+}
+udv futures = {};
+for (udv i = 0; i < )" + std::to_string(TASKS) + R"(; i = i + 1) {
+    dictSet(futures, i, spawn(fib, 15));
+}
+udv total = 0;
+for (udv i = 0; i < )" + std::to_string(TASKS) + R"(; i = i + 1) {
+    total = total + await(dictGet(futures, i));
+}
+)";
+
+static void spawnScaling(bench::Context& ctx, unsigned threads) {
+    setTaskThreads(threads);
+    lrun(SCRIPT);
+    ctx.processed(TASKS);
+    ctx.counter("threads", threads);
+}
+
+static bool registered = [] {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads *= 2) {
+        threads = std::min(threads, cores);
+        bench::Register("spawnScaling/" + std::to_string(threads), [threads](bench::Context& ctx) { spawnScaling(ctx, threads); });
+        if (threads == cores) break;
+    }
+    return true;
+}();
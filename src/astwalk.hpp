@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "expr.hpp"
+
+//Visits every node of a tree - subclasses override walk() to act on each node
+//and call the base walk() to carry on into its children
+class AstWalker : public ExprVisitor, public StmtVisitor {
+    public:
+    virtual void walk(Expr* e) {
+        if (e != nullptr) e->accept(this);
+    }
+
+    virtual void walk(Stmt* s) {
+        if (s != nullptr) s->accept(this);
+    }
+
+    void walk(const std::vector<Stmt*>& stmts) {
+        for (Stmt* s : stmts) walk(s);
+    }
+
+    std::any visitBinaryExpr(Binary* e) { walk(e->left); walk(e->right); return NULL; }
+    std::any visitGroupingExpr(Grouping* e) { walk(e->value); return NULL; }
+    std::any visitLiteralExpr(Literal* e) { return NULL; }
+    std::any visitUnaryExpr(Unary* e) { walk(e->right); return NULL; }
+    std::any visitVariableExpr(Variable* e) { return NULL; }
+    std::any visitAssignmentExpr(Assignment* e) { walk(e->expression); return NULL; }
+    std::any visitCallableExpr(Call* e) {
+        walk(e->callee);
+        for (Expr* a : e->args) walk(a);
+        return NULL;
+    }
+    std::any visitGetExpr(Get* e) { walk(e->object); return NULL; }
+    std::any visitSetExpr(Set* e) { walk(e->object); walk(e->value); return NULL; }
+    std::any visitThisExpr(This* e) { return NULL; }
+    std::any visitDictExpr(DictLiteral* e) {
+        for (Expr* k : e->keys) walk(k);
+        for (Expr* v : e->values) walk(v);
+        return NULL;
+    }
+
+    std::any visitNumBinaryExpr(NumBinary* e) { walk(e->left); walk(e->right); return NULL; }
+    std::any visitNumUnaryExpr(NumUnary* e) { walk(e->right); return NULL; }
+
+    std::any visitExpressionStmt(Expression* s) { walk(s->expression); return NULL; }
+    std::any visitPrintStmt(Print* s) { walk(s->expression); return NULL; }
+    std::any visitVarStmt(Var* s) { walk(s->initialiser); return NULL; }
+    std::any visitBlockStmt(Block* s) { walk(s->statements); return NULL; }
+    std::any visitConditionalStmt(Conditional* s) {
+        walk(s->condition);
+        walk(s->thenBranch);
+        for (Conditional* elf : s->elfs) walk((Stmt*)elf);
+        walk(s->elseBranch);
+        return NULL;
+    }
+    std::any visitCWhileStmt(CWhile* s) { walk(s->condition); walk(s->body); return NULL; }
+    std::any visitFunctionStmt(Func* s) { walk(s->body); return NULL; }
+    std::any visitClassStmt(Class* s) {
+        for (Func* m : s->methods) walk((Stmt*)m);
+        return NULL;
+    }
+    std::any visitReturnStmt(Return* s) { walk(s->returnVal); return NULL; }
+    std::any visitImportStmt(Import* s) { return NULL; }
+};
+
+//Frees a parsed program that will never be run (the interpreter keeps its trees for good)
+class AstDeleter : public AstWalker {
+    public:
+    using AstWalker::walk;
+
+    void walk(Expr* e) {
+        AstWalker::walk(e);
+        delete e;
+    }
+
+    void walk(Stmt* s) {
+        AstWalker::walk(s);
+        delete s;
+    }
+};
+
+namespace huff {
+    inline void freeAst(const std::vector<Stmt*>& stmts) {
+        AstDeleter deleter;
+        deleter.walk(stmts);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <climits>
+#include <cstdint>
+#include <algorithm>
+#include <pthread.h>
+#include "error.hpp"
+
+//Execution limits, for running scripts that can't be trusted to finish - 0 means no limit
+struct Limits {
+    //Statements (and loop iterations) executed
+    uint64_t maxSteps = 0;
+    //Wall clock milliseconds
+    uint64_t timeoutMs = 0;
+    //Nested function calls
+    size_t maxDepth = 0;
+    //Bytes in an interpreter's heap (objects, dictionary tables, instance fields & strings built with +)
+    size_t maxHeap = 0;
+};
+
+//Tracks one run against its Limits
+//Every statement counts ticks down and only calls check() when it reaches 0, so the hot path is
+//a decrement & a branch - the clock is read once every CHECK_EVERY statements
+class Budget {
+    uint64_t used = 0;
+    long batch = LONG_MAX;
+
+    void arm() {
+        if (limits.maxSteps == 0 && limits.timeoutMs == 0 && limits.maxHeap == 0) {
+            ticks = batch = LONG_MAX;
+            return;
+        }
+        batch = CHECK_EVERY;
+        if (limits.maxSteps != 0) {
+            //Stop exactly on the step after the limit
+            batch = (long)std::min<uint64_t>(batch, limits.maxSteps - used + 1);
+        }
+        ticks = batch;
+    }
+
+    public:
+    static const long CHECK_EVERY = 4096;
+
+    Limits limits;
+    long ticks = LONG_MAX;
+    std::chrono::steady_clock::time_point deadline;
+
+    //Starts counting (and the clock) from now
+    void start() {
+        used = 0;
+        if (limits.timeoutMs != 0) {
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.timeoutMs);
+        }
+        arm();
+    }
+
+    //For a spawned task or parallel worker - same limits, ending at the parent's deadline
+    void inherit(const Budget& parent) {
+        limits = parent.limits;
+        deadline = parent.deadline;
+        used = 0;
+        arm();
+    }
+
+    uint64_t steps() const {
+        return used + (batch - ticks);
+    }
+
+    //Called when ticks runs out
+    void check() {
+        used += batch;
+        if (limits.maxSteps != 0 && used > limits.maxSteps) {
+            throw new RuntimeError("Step limit of " + std::to_string(limits.maxSteps) + " statements reached", 0);
+        }
+        if (limits.timeoutMs != 0 && std::chrono::steady_clock::now() >= deadline) {
+            throw new RuntimeError("Time limit of " + std::to_string(limits.timeoutMs) + "ms reached", 0);
+        }
+        arm();
+    }
+};
+
+namespace huff {
+    //Stack the interpreter keeps free below its deepest call - natives (and the collector's
+    //callers) need room to run once the last huffle call is made
+    static const size_t STACK_RESERVE = 256 * 1024;
+
+    //Lowest address calls on this thread may reach, or null if the stack can't be found
+    inline const char* stackFloor() {
+        thread_local const char* floor = [] {
+            pthread_attr_t attr;
+            void* addr;
+            size_t size;
+            if (pthread_getattr_np(pthread_self(), &attr) != 0) return (const char*)nullptr;
+            int got = pthread_attr_getstack(&attr, &addr, &size);
+            pthread_attr_destroy(&attr);
+            if (got != 0) return (const char*)nullptr;
+            return (const char*)addr + std::min(size / 4, STACK_RESERVE);
+        }();
+        return floor;
+    }
+
+    //True once recursing further could overflow the c++ stack
+    inline bool stackExhausted() {
+        char probe;
+        const char* floor = stackFloor();
+        return floor != nullptr && &probe < floor;
+    }
+}
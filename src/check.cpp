@@ -0,0 +1,109 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include "interpreter.hpp"
+#include "error.hpp"
+#include "astwalk.hpp"
+
+namespace {
+    struct CheckResult {
+        std::string diagnostics;
+        size_t errors = 0;
+        size_t bytes = 0;
+    };
+
+    void collect(const std::string& path, std::vector<std::string>& files) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec)) {
+            for (auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".huff") {
+                    files.push_back(entry.path().string());
+                }
+            }
+        } else {
+            files.push_back(path);
+        }
+    }
+
+    CheckResult checkFile(const std::string& path) {
+        CheckResult result;
+        std::ifstream input(path);
+        if (!input) {
+            result.errors = 1;
+            result.diagnostics = "Can't open file\n";
+            return result;
+        }
+
+        std::stringstream buffer;
+        buffer << input.rdbuf();
+        std::string src = buffer.str();
+        result.bytes = src.size();
+
+        std::vector<Err*> errors;
+        std::vector<Stmt*> stmts = parseSource(src, errors);
+        huff::freeAst(stmts);
+
+        std::ostringstream out;
+        for (Err* err : errors) {
+            err->msg(out);
+            delete err;
+        }
+        result.errors = errors.size();
+        result.diagnostics = out.str();
+        return result;
+    }
+}
+
+int checkPaths(const std::vector<std::string>& paths, unsigned jobs) {
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        collect(path, files);
+    }
+    std::sort(files.begin(), files.end());
+
+    auto start = std::chrono::steady_clock::now();
+
+    //Workers take the next unchecked file until none are left
+    std::vector<CheckResult> results(files.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        huff::stats::attach();
+        for (size_t f = next++; f < files.size(); f = next++) {
+            results[f] = checkFile(files[f]);
+        }
+    };
+
+    jobs = std::max(1u, std::min<unsigned>(jobs, files.size()));
+    std::vector<std::thread> workers;
+    for (unsigned j = 1; j < jobs; j++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    //Reported in path order so output doesn't depend on scheduling
+    size_t errors = 0;
+    size_t badFiles = 0;
+    size_t bytes = 0;
+    for (size_t f = 0; f < files.size(); f++) {
+        bytes += results[f].bytes;
+        if (results[f].errors == 0) continue;
+        errors += results[f].errors;
+        badFiles++;
+        std::cout << files[f] << ":\n" << results[f].diagnostics;
+    }
+
+    printf("Checked %zu files (%.1f MB) in %.1f ms on %u threads - %.0f files/s, %zu error(s) in %zu file(s)\n",
+        files.size(), bytes / 1e6, seconds * 1000, jobs, files.size() / std::max(seconds, 1e-9), errors, badFiles);
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include "astwalk.hpp"
+
+//Closure conversion - works out which variables from enclosing scopes each function uses
+//Those become the function's captures (upvalues), and every Variable, Assignment & This that
+//reads one is pointed at its upvalue index. Names declared in no enclosing scope are globals,
+//and stay looked up by name when the function runs (so functions can use globals defined later).
+//
+//The scopes here mirror the interpreter's enviroments exactly - one per block and one per
+//function call (holding the parameters & body) - so a capture's hop count can be followed at
+//runtime. A name declared anywhere in a block counts as declared for the whole block, the same
+//as a lookup at call time sees it (so nested functions can call each other).
+class ClosureResolver : public AstWalker {
+    struct Function {
+        Func* func;
+        //Index of the function's own scope
+        long base;
+        std::map<std::string, int> upvalues;
+    };
+
+    //scopes[0] is global & never captured
+    std::vector<std::set<std::string>> scopes;
+    //Names of each scope whose declaration has run by this point of the walk
+    std::vector<std::set<std::string>> ran;
+    std::vector<Function> functions;
+
+    void declare(const std::string& name) {
+        scopes.back().insert(name);
+        ran.back().insert(name);
+    }
+
+    void enter() {
+        scopes.emplace_back();
+        ran.emplace_back();
+    }
+
+    void leave() {
+        scopes.pop_back();
+        ran.pop_back();
+    }
+
+    //Declares a block's own names up front (they're marked as run when their statement is reached)
+    void hoist(const std::vector<Stmt*>& stmts) {
+        for (Stmt* s : stmts) {
+            if (Var* v = dynamic_cast<Var*>(s)) {
+                scopes.back().insert(v->name.lexeme);
+            } else if (Func* f = dynamic_cast<Func*>(s)) {
+                scopes.back().insert(f->name.lexeme);
+            } else if (Class* c = dynamic_cast<Class*>(s)) {
+                scopes.back().insert(c->name.lexeme);
+            } else if (Import* m = dynamic_cast<Import*>(s)) {
+                scopes.back().insert(m->name.lexeme);
+            }
+        }
+    }
+
+    int add(Function& fn, const std::string& name, Capture capture) {
+        fn.func->captures.push_back(capture);
+        int index = fn.func->captures.size() - 1;
+        fn.upvalues[name] = index;
+        return index;
+    }
+
+    //Upvalue index of name in functions[f] (declared somewhere outside it), or -1 for a global
+    int upvalue(long f, const std::string& name) {
+        Function& fn = functions[f];
+        auto found = fn.upvalues.find(name);
+        if (found != fn.upvalues.end()) return found->second;
+
+        //Scopes between the function & the one enclosing it (or the top level's blocks)
+        long made = fn.base - 1;
+        long floor = f > 0 ? functions[f - 1].base : 1;
+        for (long s = made; s >= floor; s--) {
+            if (scopes[s].count(name) != 0) {
+                return add(fn, name, Capture{name, true, (int)(made - s), 0, ran[s].count(name) == 0});
+            }
+        }
+        if (f == 0) return -1;
+
+        int outer = upvalue(f - 1, name);
+        if (outer < 0) return -1;
+        return add(functions[f], name, Capture{name, false, 0, outer, false});
+    }
+
+    //Upvalue index for a use of name here, or -1 to look it up by name
+    int resolve(const std::string& name) {
+        if (functions.empty()) return -1;
+        for (long s = scopes.size() - 1; s >= functions.back().base; s--) {
+            if (scopes[s].count(name) != 0) return -1;
+        }
+        return upvalue(functions.size() - 1, name);
+    }
+
+    void function(Func* f, bool method) {
+        f->captures.clear();
+        enter();
+        functions.push_back(Function{f, (long)scopes.size() - 1, {}});
+        for (const Token& param : f->params) {
+            declare(param.lexeme);
+        }
+        if (method) declare("this");
+
+        hoist(f->body);
+        walk(f->body);
+        functions.pop_back();
+        leave();
+    }
+
+    public:
+    using AstWalker::walk;
+
+    ClosureResolver(const std::vector<Stmt*>& stmts) {
+        enter();
+        walk(stmts);
+    }
+
+    std::any visitVariableExpr(Variable* e) {
+        e->upvalue = resolve(e->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitAssignmentExpr(Assignment* e) {
+        walk(e->expression);
+        e->upvalue = resolve(e->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitThisExpr(This* e) {
+        e->upvalue = resolve("this");
+        return NULL;
+    }
+
+    std::any visitVarStmt(Var* s) {
+        walk(s->initialiser);
+        declare(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitImportStmt(Import* s) {
+        declare(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitBlockStmt(Block* s) {
+        enter();
+        hoist(s->statements);
+        walk(s->statements);
+        leave();
+        return NULL;
+    }
+
+    //The name is bound once the closure is made, so a function using its own name captures it ahead
+    std::any visitFunctionStmt(Func* s) {
+        scopes.back().insert(s->name.lexeme);
+        function(s, false);
+        declare(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitClassStmt(Class* s) {
+        scopes.back().insert(s->name.lexeme);
+        for (Func* m : s->methods) {
+            function(m, true);
+        }
+        declare(s->name.lexeme);
+        return NULL;
+    }
+};
+
+namespace huff {
+    inline void resolveClosures(const std::vector<Stmt*>& stmts) {
+        ClosureResolver resolver(stmts);
+    }
+}
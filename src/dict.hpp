@@ -0,0 +1,203 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cmath>
+#include "swissmap.hpp"
+#include "hcall.hpp"
+
+//Dictionary keys are strings or numbers - the hash is computed once when the key is made
+//A whole number double is the same key as the integer it equals
+struct DictKey {
+    std::string str;
+    double num = 0;
+    HInt integer = 0;
+    bool isStr = false;
+    bool isInt = false;
+    size_t hash = 0;
+
+    DictKey() = default;
+
+    DictKey(std::string str) {
+        this->str = std::move(str);
+        this->isStr = true;
+        this->hash = std::hash<std::string_view>()(this->str);
+    }
+
+    DictKey(HInt integer) {
+        this->integer = integer;
+        this->isInt = true;
+        this->hash = std::hash<HInt>()(integer) ^ 0x9e3779b97f4a7c15ULL;
+    }
+
+    DictKey(double num) {
+        //-0 and 0 must land on the same key
+        this->num = num == 0 ? 0 : num;
+        if (std::trunc(num) == num && num >= -0x1p63 && num < 0x1p63) {
+            *this = DictKey((HInt)num);
+            return;
+        }
+        this->hash = std::hash<double>()(this->num) ^ 0x9e3779b97f4a7c15ULL;
+    }
+
+    bool operator==(const DictKey& other) const {
+        if (hash != other.hash || isStr != other.isStr || isInt != other.isInt) return false;
+        if (isStr) return str == other.str;
+        return isInt ? integer == other.integer : num == other.num;
+    }
+
+    std::any toValue() const {
+        if (isStr) return HString(str);
+        if (isInt) return integer;
+        return num;
+    }
+};
+
+struct DictKeyHash {
+    size_t operator()(const DictKey& key) const {
+        return key.hash;
+    }
+};
+
+class Dict : public GcObject {
+    public:
+    SwissMap<DictKey, std::any, DictKeyHash> table;
+    //Bumped whenever an entry is added or removed, so iteration can detect changes
+    unsigned long version = 0;
+
+    //Inserts or overwrites, charging the owning heap for any growth of the table
+    void set(const DictKey& key, std::any val) {
+        size_t before = table.slotCount();
+        table.set(key, std::move(val));
+        if (table.slotCount() != before) {
+            owner->charge(this, (table.slotCount() - before) * (sizeof(decltype(table)::Slot) + 1));
+        }
+    }
+
+    //Makes room for n entries (charged the same way) ahead of adding them
+    void reserve(size_t n) {
+        size_t before = table.slotCount();
+        table.reserve(n);
+        if (table.slotCount() != before) {
+            owner->charge(this, (table.slotCount() - before) * (sizeof(decltype(table)::Slot) + 1));
+        }
+    }
+
+    void trace(Heap& heap) {
+        table.each([&](const DictKey& key, std::any& val) {
+            heap.markValue(val);
+        });
+    }
+};
+
+namespace huff {
+    inline DictKey toKey(const std::any& arg, int line) {
+        if (arg.type() == typeid(HString)) {
+            return DictKey(std::any_cast<const HString&>(arg).str());
+        } else if (arg.type() == typeid(HInt)) {
+            return DictKey(std::any_cast<HInt>(arg));
+        } else if (arg.type() == typeid(double)) {
+            return DictKey(std::any_cast<double>(arg));
+        }
+        throw new RuntimeError("Dictionary keys must be strings or numbers", line);
+    }
+
+    inline Dict* toDict(const std::any& arg, std::string native) {
+        if (arg.type() != typeid(Dict*)) {
+            throw new RuntimeError("Can't use " + native + "() on non-dictionary", 0);
+        }
+        return std::any_cast<Dict*>(arg);
+    }
+}
+
+class dictGet : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        Dict* d = huff::toDict(args[0], "dictGet");
+        std::any* val = d->table.get(huff::toKey(args[1], 0));
+        if (val == nullptr) {
+            throw new RuntimeError("Key not found in dictionary: " + huff::anyToString(args[1]), 0);
+        }
+        return *val;
+    }
+};
+
+class dictSet : public HCallable {
+    public:
+    int numArgs=3;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        Dict* d = huff::toDict(args[0], "dictSet");
+        i->mutating(d, "dictionary", 0);
+        size_t before = d->table.size();
+        d->set(huff::toKey(args[1], 0), args[2]);
+        if (d->table.size() != before) {
+            d->version++;
+        }
+        return args[2];
+    }
+};
+
+class dictHas : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        return huff::toDict(args[0], "dictHas")->table.has(huff::toKey(args[1], 0));
+    }
+};
+
+class dictDelete : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        Dict* d = huff::toDict(args[0], "dictDelete");
+        i->mutating(d, "dictionary", 0);
+        bool removed = d->table.erase(huff::toKey(args[1], 0));
+        if (removed) {
+            d->version++;
+        }
+        return removed;
+    }
+};
+
+class dictSize : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        return (HInt)huff::toDict(args[0], "dictSize")->table.size();
+    }
+};
+
+//Calls fn(key, value) for every entry
+class dictEach : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        Dict* d = huff::toDict(args[0], "dictEach");
+        HCallable* fn;
+        try {
+            fn = std::any_cast<HCallable*>(args[1]);
+        } catch (std::bad_any_cast& e) {
+            throw new RuntimeError("dictEach() expects a function as its second argument", 0);
+        }
+
+        unsigned long version = d->version;
+        for (size_t x = 0; x < d->table.slotCount(); x++) {
+            if (!d->table.full(x)) continue;
+
+            auto& slot = d->table.slot(x);
+            fn->call(i, std::vector<std::any>{slot.key.toValue(), slot.value});
+            if (d->version != version) {
+                throw new RuntimeError("Dictionary changed size during dictEach()", 0);
+            }
+        }
+        return NULL;
+    }
+};
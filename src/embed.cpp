@@ -0,0 +1,154 @@
+#include "embed.hpp"
+#include "visitor.hpp"
+#include "astwalk.hpp"
+#include "typeinfer.hpp"
+#include "closures.hpp"
+#include "memo.hpp"
+#include "modules.hpp"
+#include "interpreter.hpp"
+
+namespace huff {
+    bool Value::from(const std::any& val, Value& out) {
+        if (!val.has_value() || val.type() == typeid(long) || val.type() == typeid(bool)
+                || val.type() == typeid(HInt) || val.type() == typeid(double)) {
+            out.val = val;
+            return true;
+        } else if (const HString* str = std::any_cast<HString>(&val)) {
+            //The script may still hold it, so it must never be appended to in place
+            str->freeze();
+            out.val = val;
+            return true;
+        } else if (const int* i = std::any_cast<int>(&val)) {
+            out.val = (HInt)*i;
+            return true;
+        }
+        return false;
+    }
+
+    std::shared_ptr<Script> Script::compile(const std::string& source, const std::string& dir) {
+        auto script = std::make_shared<Script>();
+        std::vector<Err*> errors;
+        std::vector<Stmt*> stmts = parseSource(source, errors);
+
+        if (!errors.empty()) {
+            for (Err* e : errors) {
+                script->errors.push_back(Error{e->text(), e->line});
+                delete e;
+            }
+            freeAst(stmts);
+            return script;
+        }
+
+        resolveImports(stmts, dir);
+        resolveClosures(stmts);
+        for (Warning& w : checkMemo(stmts)) {
+            script->warnings.push_back(Error{w.text(), w.line});
+        }
+        inferTypes(stmts);
+        script->stmts = std::move(stmts);
+        return script;
+    }
+
+    Script::~Script() {
+        freeAst(stmts);
+    }
+
+    std::any HostFunction::call(Interpreter* i, std::vector<std::any> args) {
+        std::vector<Value> values(args.size());
+        for (size_t a = 0; a < args.size(); a++) {
+            if (!Value::from(args[a], values[a])) {
+                throw new RuntimeError("Host functions only take nul, bools, numbers & strings", 0);
+            }
+        }
+        return fn(values).raw();
+    }
+
+    Context::Context(std::shared_ptr<Script> script) {
+        this->script = std::move(script);
+        interp = std::make_unique<Interpreter>();
+        interp->heap.setThreshold(gcThreshold);
+        interp->heap.stress = gcStress;
+    }
+
+    Context::~Context() = default;
+
+    //Leaves the interpreter ready for the next call - an error can unwind out of any depth
+    std::optional<Error> Context::fail(Err* e) {
+        Error error{e->text(), e->line};
+        delete e;
+        interp->returning = false;
+        interp->returnValue.reset();
+        interp->env = interp->global;
+        interp->frames.clear();
+        return error;
+    }
+
+    std::optional<Error> Context::run() {
+        ran = true;
+        if (!script->ok()) {
+            return script->errors.front();
+        }
+
+        try {
+            interp->startBudget();
+            for (Stmt* stmt : script->program()) {
+                interp->step();
+                stmt->accept(interp.get());
+            }
+        } catch (Err* e) {
+            return fail(e);
+        }
+        return std::nullopt;
+    }
+
+    Result Context::call(const std::string& name, const std::vector<Value>& args) {
+        Result result;
+        if (!ran) {
+            result.error = run();
+            if (!result.ok()) return result;
+        }
+
+        std::any* found = interp->global->find(name);
+        if (found == nullptr || found->type() != typeid(HCallable*)) {
+            result.error = Error{"No function named " + name};
+            return result;
+        }
+
+        std::vector<std::any> values;
+        values.reserve(args.size());
+        for (const Value& arg : args) {
+            values.push_back(arg.raw());
+        }
+
+        try {
+            interp->startBudget();
+            std::any val = std::any_cast<HCallable*>(*found)->call(interp.get(), std::move(values));
+            if (!Value::from(val, result.value)) {
+                result.error = Error{name + " returned a value that can't leave its context (only nul, bools, numbers & strings can)"};
+            }
+        } catch (Err* e) {
+            result.error = fail(e);
+        }
+        return result;
+    }
+
+    Result Context::get(const std::string& name) {
+        Result result;
+        if (!ran) {
+            result.error = run();
+            if (!result.ok()) return result;
+        }
+
+        std::any* found = interp->global->find(name);
+        if (found == nullptr) {
+            result.error = Error{"No global named " + name};
+        } else if (!Value::from(*found, result.value)) {
+            result.error = Error{name + " can't leave its context (only nul, bools, numbers & strings can)"};
+        }
+        return result;
+    }
+
+    void Context::set(const std::string& name, const Value& val) {
+        interp->global->define(name, val.raw());
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <any>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include "hcall.hpp"
+
+//Embedding API - for running Huffle from a C++ host
+//
+//  auto script = huff::Script::compile(source);      //scan, parse & infer once
+//  huff::Context ctx(script);                         //one per thread, cheap to make
+//  ctx.function("log", [](std::vector<huff::Value>& args) { ...; return huff::Value(); });
+//  huff::Result r = ctx.call("score", {42, "name"});  //runs the top level first if needed
+//  if (!r.ok()) std::cerr << r.error->message;
+//
+//Nothing is printed on error - every failure comes back as an Error value, including a script
+//running past ctx.limits() (statements, time, call depth or heap)
+namespace huff {
+    struct Error {
+        std::string message;
+        int line = 0;
+    };
+
+    //A value crossing between the host and a script - nul, a bool, an integer, a double or a string
+    //Dictionaries, instances & functions can't leave the context that made them
+    class Value {
+        std::any val;
+
+        public:
+        Value() = default;
+        Value(bool b) : val(b) {}
+        Value(int i) : val((HInt)i) {}
+        Value(HInt i) : val(i) {}
+        Value(double d) : val(d) {}
+        Value(std::string s) : val(HString(std::move(s))) {}
+        Value(const char* s) : val(HString(s)) {}
+
+        bool isNul() const { return !val.has_value() || val.type() == typeid(long); }
+        bool isBool() const { return val.type() == typeid(bool); }
+        bool isInt() const { return val.type() == typeid(HInt); }
+        bool isDouble() const { return val.type() == typeid(double); }
+        bool isNumber() const { return isInt() || isDouble(); }
+        bool isString() const { return val.type() == typeid(HString); }
+
+        //Each of these must only be used on a value of that kind - asDouble also takes integers
+        bool asBool() const { return std::any_cast<bool>(val); }
+        HInt asInt() const { return toInt(val); }
+        double asDouble() const { return promote(val); }
+        std::string asString() const { return std::any_cast<const HString&>(val).str(); }
+
+        //As a script would print it
+        std::string str() const { return anyToString(val); }
+
+        //The interpreter's representation
+        const std::any& raw() const { return val; }
+
+        //False (and out untouched) if val can't leave its context
+        static bool from(const std::any& val, Value& out);
+    };
+
+    //The outcome of a call - a value, or the error that stopped it
+    struct Result {
+        Value value;
+        std::optional<Error> error;
+
+        bool ok() const { return !error.has_value(); }
+    };
+
+    //A compiled program - read only once compiled, so any number of contexts on any threads can share it
+    class Script {
+        std::vector<Stmt*> stmts;
+
+        public:
+        //Every scan & parse error, in line order - a script with errors can't be run
+        std::vector<Error> errors;
+        //Things the script does that it probably shouldn't (ie: output from a @memo function)
+        std::vector<Error> warnings;
+
+        //Imports are found relative to dir
+        static std::shared_ptr<Script> compile(const std::string& source, const std::string& dir = ".");
+
+        Script() = default;
+        Script(const Script&) = delete;
+        ~Script();
+
+        bool ok() const { return errors.empty(); }
+        const std::vector<Stmt*>& program() const { return stmts; }
+    };
+
+    //Host function wrapped as a native - throw new RuntimeError(...) from it to fail the call
+    class HostFunction : public HCallable {
+        public:
+        int numArgs=-1;
+        std::function<Value(std::vector<Value>&)> fn;
+
+        HostFunction(std::function<Value(std::vector<Value>&)> fn) {
+            this->fn = std::move(fn);
+        }
+
+        std::any call(Interpreter* i, std::vector<std::any> args);
+    };
+
+    //The globals (and heap) of one run of a script
+    //Not thread safe - give each thread a context of its own
+    class Context {
+        std::shared_ptr<Script> script;
+        std::unique_ptr<Interpreter> interp;
+        bool ran = false;
+
+        std::optional<Error> fail(Err* e);
+
+        public:
+        Context(std::shared_ptr<Script> script);
+        ~Context();
+
+        //Runs the script's top level, defining its functions & globals - call() does this on first use,
+        //so run it first only to register natives the top level needs or to check it succeeds
+        std::optional<Error> run();
+
+        //Calls a global function by name
+        Result call(const std::string& name, const std::vector<Value>& args = {});
+
+        //Limits for each run() & call() from now on - every call starts with a fresh budget
+        Limits& limits() { return interp->budget.limits; }
+
+        Result get(const std::string& name);
+        void set(const std::string& name, const Value& val);
+
+        //Registers a native - T is any HCallable, made in this context's heap
+        template<typename T, typename... Args> T* native(const std::string& name, Args&&... args) {
+            T* callable = interp->heap.template make<T>(std::forward<Args>(args)...);
+            interp->global->define(name, (HCallable*)callable);
+            return callable;
+        }
+
+        HostFunction* function(const std::string& name, std::function<Value(std::vector<Value>&)> fn) {
+            return native<HostFunction>(name, std::move(fn));
+        }
+
+        Interpreter& interpreter() { return *interp; }
+    };
+}
@@ -4,75 +4,184 @@
 #include <variant>
 #include "token.hpp"
 #include "error.hpp"
+#include "gc.hpp"
 
-class Enviroment {
+class Enviroment;
+
+//A variable captured by a closure (Lua style)
+//Open while the scope that declared it runs - location points at the variable itself, so the
+//scope & every closure see each other's assignments - then closed when the scope exits, taking
+//the value with it so the scope can be freed
+class Upvalue : public GcObject {
+    public:
+    std::any* location;
+    std::any closed;
+    //Declaring scope while open, nullptr once closed
+    Enviroment* env;
+    //Next open upvalue of the same scope
+    Upvalue* next = nullptr;
+
+    Upvalue(std::any* location, Enviroment* env) {
+        this->location = location;
+        this->env = env;
+    }
+
+    //Closed over a copy of val, for a closure rebuilt on another interpreter
+    Upvalue(const std::any& val) {
+        this->closed = val;
+        this->location = &closed;
+        this->env = nullptr;
+    }
+
+    void close() {
+        closed = *location;
+        location = &closed;
+        env = nullptr;
+    }
+
+    void trace(Heap& heap);
+};
+
+class Enviroment : public GcObject {
     std::map<std::string, std::any> values;
     public:
     Enviroment* enclosing;
     bool isFunc;
+    //Upvalues still pointing into this scope
+    Upvalue* open = nullptr;
 
     //Global constructor
     Enviroment(bool isFunc) {
         this->isFunc = isFunc;
         this->enclosing = nullptr;
+        HUFF_COUNT(enviroments);
     }
     //Local constructor
     Enviroment(bool isFunc, Enviroment* enclosing) {
         this->enclosing = enclosing;
         this->isFunc = isFunc;
+        HUFF_COUNT(enviroments);
     }
 
 
     //Enviroment operations
-    void define(Token name, std::any val) {
-        values[name.lexeme] = val;
+    //Values are taken by value & moved in, so a temporary (ie: a call's result) is never copied
+    void define(const Token& name, std::any val) {
+        values[name.lexeme] = std::move(val);
     }
 
-    void define(std::string lex, std::any val) {
-        values[lex] = val;
+    void define(const std::string& lex, std::any val) {
+        values[lex] = std::move(val);
     }
 
-    void assign(Token name, std::any val) {
-        if (values.find(name.lexeme) != values.end()) {
-            values[name.lexeme] = val;
-            return;
-        } 
+    //A variable whose place is kept (see reserve) but that isn't declared yet is skipped over
+    void assign(const Token& name, std::any val) {
+        for (Enviroment* at = this; at != nullptr; at = at->enclosing) {
+            auto found = at->values.find(name.lexeme);
+            if (found != at->values.end() && found->second.has_value()) {
+                found->second = std::move(val);
+                return;
+            }
+        }
 
-        if (enclosing != nullptr){
-            enclosing->assign(name,val);
-            return;
-        } 
+        throw (new RuntimeError("Failed to find variable: " + name.lexeme, name.line));  
+    }
 
+    void assign(const std::string& lex, std::any val) {
+        for (Enviroment* at = this; at != nullptr; at = at->enclosing) {
+            auto found = at->values.find(lex);
+            if (found != at->values.end() && found->second.has_value()) {
+                found->second = std::move(val);
+                return;
+            }
+        }
 
-        throw (new RuntimeError("Failed to find variable: " + name.lexeme, name.line));  
+        throw (new RuntimeError("Failed to find variable: " + lex, 0));  
     }
 
-    void assign(std::string lex, std::any val) {
-        if (values.find(lex) != values.end()) {
-            values[lex] = val;
-            return;
-        } 
+    std::any pull(const Token& name) {
+        HUFF_COUNT(lookups);
+        //Traverse denested enviroments, innermost first
+        for (Enviroment* at = this; at != nullptr; at = at->enclosing) {
+            HUFF_COUNT(lookupDepth);
+            auto found = at->values.find(name.lexeme);
+            if (found != at->values.end() && found->second.has_value()) {
+                return found->second;
+            }
+        }
 
-        if (enclosing != nullptr){
-            enclosing->assign(lex,val);
-            return;
-        } 
+        throw (new RuntimeError("Failed to find variable: " + name.lexeme, name.line));   
+    }
 
+    //Scope lex is defined in (this one or an enclosing one), or nullptr
+    Enviroment* holder(const std::string& lex) {
+        for (Enviroment* at = this; at != nullptr; at = at->enclosing) {
+            auto found = at->values.find(lex);
+            if (found != at->values.end() && found->second.has_value()) return at;
+        }
+        return nullptr;
+    }
 
-        throw (new RuntimeError("Failed to find variable: " + lex, 0));  
+    //Value defined in this scope alone (not enclosing ones), or nullptr
+    std::any* find(const std::string& lex) {
+        auto found = values.find(lex);
+        return found == values.end() ? nullptr : &found->second;
     }
 
-    std::any pull(Token name) {
-        if (values.find(name.lexeme) != values.end()) {
-            return values[name.lexeme];
+    //Where lex is in this scope - stays put for the scope's lifetime
+    std::any* slot(const std::string& lex) {
+        auto found = values.find(lex);
+        if (found == values.end()) {
+            throw (new RuntimeError("Failed to find variable: " + lex, 0));
         }
+        return &found->second;
+    }
 
-        //Recursively traverse denested enviroments
-        //Infinite enviroments
-        if (enclosing != nullptr){
-            return enclosing->pull(name);
-        } 
+    //Keeps lex's place in this scope for a declaration that hasn't run yet - until it does, the
+    //variable holds no value and reading it is an error
+    std::any* reserve(const std::string& lex) {
+        return &values[lex];
+    }
 
-        throw (new RuntimeError("Failed to find variable: " + name.lexeme, name.line));   
+    //Open upvalue for the variable at slot, made if this is its first capture
+    Upvalue* capture(Heap& heap, std::any* slot);
+
+    //Called as the scope exits
+    void closeUpvalues() {
+        for (Upvalue* up = open; up != nullptr; up = up->next) {
+            up->close();
+        }
+        open = nullptr;
+    }
+
+    template<typename F> void each(F fn) {
+        for (auto& v : values) {
+            fn(v.first, v.second);
+        }
+    }
+
+    void trace(Heap& heap) {
+        heap.mark(enclosing);
+        for (Upvalue* up = open; up != nullptr; up = up->next) {
+            heap.mark(up);
+        }
+        for (auto& v : values) {
+            heap.markValue(v.second);
+        }
     }
 };
+
+inline void Upvalue::trace(Heap& heap) {
+    heap.mark(env);
+    heap.markValue(closed);
+}
+
+inline Upvalue* Enviroment::capture(Heap& heap, std::any* slot) {
+    for (Upvalue* up = open; up != nullptr; up = up->next) {
+        if (up->location == slot) return up;
+    }
+    Upvalue* up = heap.make<Upvalue>(slot, this);
+    up->next = open;
+    open = up;
+    return up;
+}
@@ -2,11 +2,15 @@
 
 #include <iostream>
 #include "token.hpp"
+#include "stats.hpp"
 
 class Err {
     public:
     int line;
-    virtual void msg() = 0;
+    virtual ~Err() = default;
+    virtual void msg(std::ostream& out = std::cout) = 0;
+    //The message without colours or line, for callers that report errors themselves
+    virtual std::string text() = 0;
 };
 
 class UnexpectedSequence : public Err {  
@@ -18,8 +22,12 @@ class UnexpectedSequence : public Err {
         this->literal = literal;
     }
 
-    void msg() {
-        std::cout << "\033[1;31;43m[HUFFL]\033[0m \033[31m Invalid sequence:\033[32m " << literal << "\033[0m on line " << line << "\n\n";
+    void msg(std::ostream& out = std::cout) {
+        out << "\033[1;31;43m[HUFFL]\033[0m \033[31m Invalid sequence:\033[32m " << literal << "\033[0m on line " << line << "\n\n";
+    }
+
+    std::string text() {
+        return "Invalid sequence: " + literal;
     }
 };
 
@@ -32,10 +40,15 @@ class CastError : public Err {
         this->line = line;
         this->arg = arg;
         this->m = m;
+        HUFF_COUNT(errors);
     }
 
-    void msg() {
-        std::cout << "\033[1;31;43m[HUFFL]\033[0m \033[31m Invalid cast:\033[32m " << m << "\033[0m" << arg << "\033[0m on line " << line << "\n\n";
+    void msg(std::ostream& out = std::cout) {
+        out << "\033[1;31;43m[HUFFL]\033[0m \033[31m Invalid cast:\033[32m " << m << "\033[0m" << arg << "\033[0m on line " << line << "\n\n";
+    }
+
+    std::string text() {
+        return "Invalid cast: " + m + arg;
     }
 };
 
@@ -46,11 +59,16 @@ class RuntimeError : public Err {
     RuntimeError(std::string m, int line) {
         this->m = m;
         this->line = line;
+        HUFF_COUNT(errors);
+
+    }
 
+    void msg(std::ostream& out = std::cout) {
+        out << "\033[1;31;43m[HUFFL]\033[0m \033[31m Runtime Error:\033[32m " << m << "\033[0m on line " << line << "\n\n";
     }
 
-    void msg() {
-        std::cout << "\033[1;31;43m[HUFFL]\033[0m \033[31m Runtime Error:\033[32m " << m << "\033[0m on line " << line << "\n\n";
+    std::string text() {
+        return "Runtime Error: " + m;
     }
 };
 
@@ -63,7 +81,30 @@ class ParseError : public Err {
         this->line = line;
     }
 
-    void msg() {
-        std::cout <<  "\033[1;31;43m[HUFFL]\033[0m \033[31m Parse error:\033[32m " << this->m << "\033[0m on line " << line << "\n\n";
+    void msg(std::ostream& out = std::cout) {
+        out <<  "\033[1;31;43m[HUFFL]\033[0m \033[31m Parse error:\033[32m " << this->m << "\033[0m on line " << line << "\n\n";
+    }
+
+    std::string text() {
+        return "Parse error: " + m;
+    }
+};
+
+//Reported before a program runs, which it still does
+class Warning : public Err {
+    std::string m;
+
+    public:
+    Warning(std::string m, int line) {
+        this->m = m;
+        this->line = line;
+    }
+
+    void msg(std::ostream& out = std::cout) {
+        out << "\033[1;30;43m[HUFFL]\033[0m \033[33m Warning:\033[32m " << m << "\033[0m on line " << line << "\n\n";
+    }
+
+    std::string text() {
+        return "Warning: " + m;
     }
 };
@@ -3,6 +3,8 @@
 #include "token.hpp"
 #include <any>
 #include <vector>
+#include <atomic>
+#include <cstdint>
 
 class Binary;
 class Grouping;
@@ -21,6 +23,14 @@ class Call;
 class Func;
 class Class;
 class Return;
+class Import;
+class Get;
+class Set;
+class This;
+class DictLiteral;
+class NumBinary;
+class NumUnary;
+class Shape;
 
 enum LiteralType {
     INT, STR
@@ -36,6 +46,12 @@ struct ExprVisitor {
     virtual std::any visitVariableExpr(Variable* expr)=0;
     virtual std::any visitAssignmentExpr(Assignment* expr)=0;
     virtual std::any visitCallableExpr(Call* expr)=0;
+    virtual std::any visitGetExpr(Get* expr)=0;
+    virtual std::any visitSetExpr(Set* expr)=0;
+    virtual std::any visitThisExpr(This* expr)=0;
+    virtual std::any visitDictExpr(DictLiteral* expr)=0;
+    virtual std::any visitNumBinaryExpr(NumBinary* expr)=0;
+    virtual std::any visitNumUnaryExpr(NumUnary* expr)=0;
 };
 
 struct StmtVisitor {
@@ -48,11 +64,13 @@ struct StmtVisitor {
     virtual std::any visitFunctionStmt(Func* expr)=0;
     virtual std::any visitClassStmt(Class* expr)=0;
     virtual std::any visitReturnStmt(Return* expr)=0;
+    virtual std::any visitImportStmt(Import* expr)=0;
 };
 
 
 struct Stmt {
     public:
+    virtual ~Stmt() = default;
     virtual std::any accept(StmtVisitor* v)=0;
 };
 
@@ -62,7 +80,7 @@ class Class : public Stmt {
     Token name;
     std::vector<Func*> methods;
 
-    Class (Token name, std::vector<Func*> methods) {
+    Class (const Token& name, std::vector<Func*> methods) {
         this->name = name;
         this->methods = methods;
     }
@@ -88,9 +106,11 @@ class Expression : public Stmt {
 class Print : public Stmt {
     public:
     Expr* expression;
+    int line;
 
-    Print (Expr* expression){
+    Print (Expr* expression, int line = 0){
         this->expression = expression;
+        this->line = line;
     }
 
     std::any accept(StmtVisitor* v) {
@@ -116,7 +136,7 @@ class Var : public Stmt {
     Expr* initialiser;
     Token name;
 
-    Var (Token name,  Expr* initialiser) {
+    Var (const Token& name,  Expr* initialiser) {
         this->name = name;
         this->initialiser = initialiser;
     }
@@ -138,13 +158,32 @@ class Block : public  Stmt {
     }
 };
 
+//A variable declared outside a function that the function uses - set by the closure resolver
+//Either local to the scope hops out from where the function is made, or the index of one of
+//the enclosing function's own captures
+struct Capture {
+    std::string name;
+    bool local;
+    int hops;
+    int index;
+    //A local whose declaration hasn't run yet when the function is made (a function calling
+    //itself, or one declared after it) - its place is kept for it until then
+    bool forward;
+};
+
 class Func : public Stmt {
     public:
     std::vector<Token> params;
     Token name;
     std::vector<Stmt*> body;
-
-    Func(Token name, std::vector<Token> params, std::vector<Stmt*> body) {
+    //Upvalues every closure of this function holds, in order
+    std::vector<Capture> captures;
+    //Set by @memo - results are cached on argument values, keeping the memoLimit most recently
+    //used (0 for no limit)
+    bool memo = false;
+    size_t memoLimit = 0;
+
+    Func(const Token& name, std::vector<Token> params, std::vector<Stmt*> body) {
         this->name = name;
         this->params = params;
         this->body = body;
@@ -155,6 +194,26 @@ class Func : public Stmt {
     }
 };
 
+//import a.b.c; - binds c to the module in a/b/c.huff, loaded on first use
+class Import : public Stmt {
+    public:
+    Token keyword;
+    std::vector<Token> path;
+    Token name;
+    //Resolved module file, set before the program runs (relative to the importing file)
+    std::string file;
+
+    Import(const Token& keyword, std::vector<Token> path) {
+        this->keyword = keyword;
+        this->path = path;
+        this->name = path.back();
+    }
+
+    std::any accept(StmtVisitor* v) {
+        return v->visitImportStmt(this);
+    }
+};
+
 class Conditional : public Stmt {
     public:
     Expr* condition;
@@ -185,10 +244,13 @@ class CWhile : public Stmt{
     public:
     Expr* condition;
     Stmt* body; 
+    //The while or for keyword
+    Token keyword;
 
-    CWhile(Expr* condition, Stmt* body) {
+    CWhile(Expr* condition, Stmt* body, const Token& keyword) {
         this->condition = condition;
         this->body = body;
+        this->keyword = keyword;
     }
 
     std::any accept(StmtVisitor* v) {
@@ -200,6 +262,7 @@ class CWhile : public Stmt{
 //Logical & Arithmetic Expressions
 struct Expr {
     public:
+    virtual ~Expr() = default;
     virtual std::any accept(ExprVisitor* v)=0;
 };
 
@@ -209,7 +272,7 @@ class Binary : public Expr {
     Expr* right;
     Token op;
 
-    Binary(Expr* l, Token op, Expr* r) {
+    Binary(Expr* l, const Token& op, Expr* r) {
         this->left = l;
         this->right = r;
         this->op = op;
@@ -224,8 +287,10 @@ class Assignment : public Expr {
     public:
     Expr* expression;
     Token name;
+    //Index into the running function's upvalues, or -1 to look the name up
+    int upvalue = -1;
 
-    Assignment(Token name, Expr* expression) {
+    Assignment(const Token& name, Expr* expression) {
         this->name = name;
         this->expression = expression;
     }  
@@ -252,8 +317,10 @@ class Literal : public Expr {
 class Variable : public Expr {
     public:
     Token name;
+    //Index into the running function's upvalues, or -1 to look the name up
+    int upvalue = -1;
 
-    Variable(Token name) {
+    Variable(const Token& name) {
         this->name = name;
     }
 
@@ -281,7 +348,7 @@ class Call : public Expr {
     Expr* callee;
     Token paren;
 
-    Call (Expr* callee, std::vector<Expr*> args, Token paren) {
+    Call (Expr* callee, std::vector<Expr*> args, const Token& paren) {
         this->callee = callee;
         this->args = args;
         this->paren = paren;
@@ -298,7 +365,7 @@ class Unary : public Expr {
     Expr* right;
     
 
-    Unary(Token op, Expr* right) {
+    Unary(const Token& op, Expr* right) {
         this->op = op;
         this->right = right;
     }
@@ -307,3 +374,117 @@ class Unary : public Expr {
         return v->visitUnaryExpr(this);
     }
 };
+
+//Property access - caches the shape & slot of the last instance seen (inline cache)
+//The cache is one word (shape id << 16 | slot) so threads running the same tree never see a torn entry
+class Get : public Expr {
+    public:
+    Expr* object;
+    Token name;
+    std::atomic<uint64_t> cache{0};
+
+    Get(Expr* object, const Token& name) {
+        this->object = object;
+        this->name = name;
+    }
+
+    std::any accept(ExprVisitor* v) {
+        return v->visitGetExpr(this);
+    }
+};
+
+//Property assignment - caches the shape & slot of the last instance seen, and whether
+//the field was added (shape id << 17 | added << 16 | slot), in one word like Get
+class Set : public Expr {
+    public:
+    Expr* object;
+    Token name;
+    Expr* value;
+    std::atomic<uint64_t> cache{0};
+
+    Set(Expr* object, const Token& name, Expr* value) {
+        this->object = object;
+        this->name = name;
+        this->value = value;
+    }
+
+    std::any accept(ExprVisitor* v) {
+        return v->visitSetExpr(this);
+    }
+};
+
+class This : public Expr {
+    public:
+    Token keyword;
+    //Set inside a function nested in a method - see Variable
+    int upvalue = -1;
+
+    This(const Token& keyword) {
+        this->keyword = keyword;
+    }
+
+    std::any accept(ExprVisitor* v) {
+        return v->visitThisExpr(this);
+    }
+};
+
+//Dictionary literal, ie: {"a": 1, "b": 2}
+class DictLiteral : public Expr {
+    public:
+    std::vector<Expr*> keys;
+    std::vector<Expr*> values;
+    Token brace;
+
+    DictLiteral(std::vector<Expr*> keys, std::vector<Expr*> values, const Token& brace) {
+        this->keys = keys;
+        this->values = values;
+        this->brace = brace;
+    }
+
+    std::any accept(ExprVisitor* v) {
+        return v->visitDictExpr(this);
+    }
+};
+
+//Which kind of number an operand of NumBinary / NumUnary was proved to be
+enum NumKind {
+    K_INT, K_DOUBLE, K_EITHER
+};
+
+//Arithmetic or comparison whose operands type inference proved are always numbers
+//Replaces a Binary, and is evaluated without any type checks (see typeinfer.hpp)
+class NumBinary : public Expr {
+    public:
+    Expr* left;
+    Expr* right;
+    Token op;
+    NumKind leftKind = K_EITHER;
+    NumKind rightKind = K_EITHER;
+
+    NumBinary(Expr* l, const Token& op, Expr* r) {
+        this->left = l;
+        this->right = r;
+        this->op = op;
+    }
+
+    std::any accept(ExprVisitor* v) {
+        return v->visitNumBinaryExpr(this);
+    }
+};
+
+//Negation of a value proved to be a number
+class NumUnary : public Expr {
+    public:
+    Token op;
+    Expr* right;
+    NumKind kind = K_EITHER;
+
+    NumUnary(const Token& op, Expr* right) {
+        this->op = op;
+        this->right = right;
+    }
+
+    std::any accept(ExprVisitor* v) {
+        return v->visitNumUnaryExpr(this);
+    }
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hcall.hpp"
+#include "hstring.hpp"
+#include "strsearch.hpp"
+
+//String buffer over a memory mapped file, unmapped when the last string using it goes
+struct MappedBuf : public StrBuf {
+    size_t mappedSize;
+
+    MappedBuf(const char* bytes, size_t size) {
+        this->external = bytes;
+        this->mappedSize = size;
+        this->frozen = true;
+    }
+
+    ~MappedBuf() {
+        munmap((void*)external, mappedSize);
+    }
+};
+
+//File opened by a script - reads & writes go through large buffers
+//Lines are handed out as views into the read chunk they were found in, so
+//scanning a file copies each byte once (from the kernel) rather than per line
+class HFile : public GcObject {
+    static constexpr size_t CHUNK = 1024 * 1024;
+
+    int fd = -1;
+    bool writing = false;
+    bool atEof = false;
+
+    //Read side - chunk holds bytes [pos, end) not yet returned
+    std::shared_ptr<StrBuf> chunk;
+    size_t pos = 0;
+    size_t end = 0;
+
+    //Write side
+    std::string out;
+
+    public:
+    std::string path;
+
+    HFile(std::string path, std::string mode) {
+        this->path = path;
+        if (mode == "r") {
+            fd = ::open(path.c_str(), O_RDONLY);
+        } else if (mode == "w") {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            writing = true;
+        } else if (mode == "a") {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            writing = true;
+        } else {
+            throw new RuntimeError("Invalid file mode '" + mode + "' (expected r, w or a)", 0);
+        }
+
+        if (fd < 0) {
+            throw new RuntimeError("Can't open file: " + path, 0);
+        }
+        out.reserve(writing ? CHUNK : 0);
+    }
+
+    ~HFile() {
+        close();
+    }
+
+    bool isOpen() {
+        return fd >= 0;
+    }
+
+    void close() {
+        if (fd < 0) return;
+        flush();
+        ::close(fd);
+        fd = -1;
+    }
+
+    void requireOpen(bool forWriting) {
+        if (fd < 0) {
+            throw new RuntimeError("File is closed: " + path, 0);
+        }
+        if (forWriting != writing) {
+            throw new RuntimeError(std::string("File is not open for ") + (forWriting ? "writing: " : "reading: ") + path, 0);
+        }
+    }
+
+    //Reads more bytes, keeping the unreturned tail [pos, end) - returns false at end of file
+    bool fill() {
+        if (atEof) return false;
+
+        size_t pending = end - pos;
+        size_t size = std::max(CHUNK, pending * 2);
+        if (chunk != nullptr && chunk.use_count() == 1 && size <= chunk->data.size()) {
+            //No string views this chunk - slide the tail to the front and reuse it
+            memmove(chunk->data.data(), chunk->data.data() + pos, pending);
+            pos = 0;
+            end = pending;
+        } else if (chunk == nullptr || pos != 0 || end == chunk->data.size()) {
+            //Strings may still view the old chunk, so move the tail to a fresh one rather than reuse it
+            auto next = std::make_shared<StrBuf>();
+            next->frozen = true;
+            next->data.resize(size);
+            if (pending > 0) {
+                memcpy(next->data.data(), chunk->data.data() + pos, pending);
+            }
+            chunk = next;
+            pos = 0;
+            end = pending;
+        }
+
+        ssize_t got;
+        do {
+            got = ::read(fd, chunk->data.data() + end, chunk->data.size() - end);
+        } while (got < 0 && errno == EINTR);
+
+        if (got <= 0) {
+            atEof = true;
+            return false;
+        }
+        end += got;
+        return true;
+    }
+
+    bool eof() {
+        requireOpen(false);
+        return pos == end && !fill();
+    }
+
+    HString readLine() {
+        requireOpen(false);
+
+        size_t scanned = pos;
+        while (true) {
+            const char* data = chunk == nullptr ? nullptr : chunk->data.data();
+            const void* nl = data == nullptr ? nullptr : memchr(data + scanned, '\n', end - scanned);
+            if (nl != nullptr) {
+                size_t at = (const char*)nl - data;
+                HString line(chunk, pos, at - pos);
+                pos = at + 1;
+                return line;
+            }
+
+            //No newline buffered - remember how far we looked (fill() moves pending bytes to the front)
+            size_t looked = end - pos;
+            if (!fill()) {
+                HString line = end > pos ? HString(chunk, pos, end - pos) : HString();
+                pos = end;
+                return line;
+            }
+            scanned = pos + looked;
+        }
+    }
+
+    HString readAll() {
+        requireOpen(false);
+
+        //Nothing read yet - map the file rather than copying it
+        struct stat info;
+        if (chunk == nullptr && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            off_t at = lseek(fd, 0, SEEK_CUR);
+            if (at == 0) {
+                void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+                    lseek(fd, 0, SEEK_END);
+                    atEof = true;
+                    return HString(std::make_shared<MappedBuf>((const char*)mapped, info.st_size), 0, info.st_size);
+                }
+            }
+        }
+
+        std::string all(chunk == nullptr ? "" : std::string(chunk->data.data() + pos, end - pos));
+        pos = end;
+        char buffer[64 * 1024];
+        ssize_t got;
+        while ((got = ::read(fd, buffer, sizeof(buffer))) != 0) {
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            all.append(buffer, got);
+        }
+        atEof = true;
+        return HString(std::move(all));
+    }
+
+    void write(std::string_view str) {
+        requireOpen(true);
+        out.append(str);
+        if (out.size() >= CHUNK) {
+            flush();
+        }
+    }
+
+    void flush() {
+        size_t done = 0;
+        while (done < out.size()) {
+            ssize_t put = ::write(fd, out.data() + done, out.size() - done);
+            if (put < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            done += put;
+        }
+        out.clear();
+    }
+};
+
+namespace huff {
+    inline HFile* toFile(const std::any& arg, std::string native) {
+        if (arg.type() != typeid(HFile*)) {
+            throw new RuntimeError("Can't use " + native + "() on non-file", 0);
+        }
+        return std::any_cast<HFile*>(arg);
+    }
+}
+
+//open( path, mode ) - mode is "r", "w" or "a"
+class fileOpen : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        if (args.size() != 2 || args[0].type() != typeid(HString) || args[1].type() != typeid(HString)) {
+            throw new RuntimeError("open() expects a path and a mode string", 0);
+        }
+        return i->heap.make<HFile>(std::any_cast<HString&>(args[0]).str(), std::any_cast<HString&>(args[1]).str());
+    }
+};
+
+//Next line without its newline - "" once the file is exhausted (check with eof())
+class fileReadLine : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        HFile* file = huff::toFile(args[0], "readLine");
+        i->mutating(file, "file", 0);
+        return file->readLine();
+    }
+};
+
+class fileReadAll : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        HFile* file = huff::toFile(args[0], "readAll");
+        i->mutating(file, "file", 0);
+        return file->readAll();
+    }
+};
+
+class fileEof : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        //Checking refills the read buffer
+        HFile* file = huff::toFile(args[0], "eof");
+        i->mutating(file, "file", 0);
+        return file->eof();
+    }
+};
+
+class fileWrite : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        HFile* file = huff::toFile(args[0], "write");
+        i->mutating(file, "file", 0);
+        if (args[1].type() == typeid(HString)) {
+            file->write(std::any_cast<HString&>(args[1]).view());
+        } else {
+            file->write(huff::anyToString(args[1]));
+        }
+        return NULL;
+    }
+};
+
+class fileClose : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        HFile* file = huff::toFile(args[0], "close");
+        i->mutating(file, "file", 0);
+        file->close();
+        return NULL;
+    }
+};
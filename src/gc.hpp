@@ -0,0 +1,227 @@
+#pragma once
+
+#include <any>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <string>
+#include <algorithm>
+#include "error.hpp"
+#include "stats.hpp"
+#include "hstring.hpp"
+
+class Heap;
+
+//Base for everything the interpreter allocates at runtime (enviroments, callables)
+//Objects are owned by a Heap and freed by mark & sweep once unreachable
+class GcObject {
+    public:
+    bool marked = false;
+    size_t gcSize = 0;
+    //Heap that allocated (and will free) this object - other heaps never mark it
+    Heap* owner = nullptr;
+
+    virtual ~GcObject() = default;
+
+    //Mark every object this one references
+    virtual void trace(Heap& heap) {}
+};
+
+//Implemented by the interpreter - hands its root set to the collector
+struct GcRoots {
+    virtual void markRoots(Heap& heap) = 0;
+};
+
+class Heap {
+    std::vector<GcObject*> objects;
+    std::vector<GcObject*> grey;
+    std::vector<const std::any*> tempRoots;
+    std::vector<GcObject*> tempObjects;
+    size_t bytesAllocated = 0;
+    size_t nextGC;
+
+    public:
+    GcRoots* roots = nullptr;
+
+    //Bytes allocated before the first collection, and minimum heap size after one
+    size_t threshold;
+    //Heap may grow to live size * growFactor before the next collection
+    double growFactor = 2.0;
+    //Collect on every allocation (for testing)
+    bool stress = false;
+    //Most bytes the heap may hold once collected (0 for no limit)
+    size_t limit = 0;
+
+    size_t collections = 0;
+    size_t freed = 0;
+
+    //String buffers this heap's interpreter has built - freed by their own reference counts, not
+    //by collection, but held to the limit with everything else
+    std::shared_ptr<StrMeter> strings = std::make_shared<StrMeter>();
+
+    Heap(size_t threshold = 1024 * 1024) {
+        setThreshold(threshold);
+    }
+
+    void setThreshold(size_t bytes) {
+        this->threshold = bytes;
+        this->nextGC = bytes;
+    }
+
+    void setLimit(size_t bytes) {
+        this->limit = bytes;
+        if (bytes != 0) {
+            this->nextGC = std::min(nextGC, bytes);
+        }
+    }
+
+    ~Heap() {
+        for (GcObject* o : objects) {
+            delete o;
+        }
+    }
+
+    template<typename T, typename... Args> T* make(Args&&... args) {
+        if (stress || bytesAllocated + sizeof(T) > nextGC) {
+            collect();
+            checkLimit(sizeof(T));
+        }
+
+        T* obj = new T(std::forward<Args>(args)...);
+        obj->gcSize = sizeof(T);
+        obj->owner = this;
+        bytesAllocated += sizeof(T);
+        HUFF_COUNT_BY(bytes, sizeof(T));
+        objects.push_back(obj);
+        return obj;
+    }
+
+    //Objects of other heaps are skipped - a parallel worker's scopes can enclose its
+    //spawner's, and only the spawner's heap may trace (or free) those
+    void mark(GcObject* obj) {
+        if (obj == nullptr || obj->owner != this || obj->marked) return;
+        obj->marked = true;
+        grey.push_back(obj);
+    }
+
+    void markValue(const std::any& val);
+
+    //The object a value refers to, or nullptr for numbers, strings, bools & nul
+    static GcObject* objectOf(const std::any& val);
+
+    //Keep values that only live on the c++ stack (call args, operands) alive
+    void pushRoot(const std::any* val) {
+        tempRoots.push_back(val);
+    }
+
+    void pushRoot(GcObject* obj) {
+        tempObjects.push_back(obj);
+    }
+
+    std::pair<size_t, size_t> rootDepth() {
+        return {tempRoots.size(), tempObjects.size()};
+    }
+
+    void restoreRoots(std::pair<size_t, size_t> depth) {
+        tempRoots.resize(depth.first);
+        tempObjects.resize(depth.second);
+    }
+
+    size_t liveObjects() {
+        return objects.size();
+    }
+
+    size_t bytes() {
+        return bytesAllocated + strings->bytes.load(std::memory_order_relaxed);
+    }
+
+    //Counts memory an object has grown by since it was made (a dictionary's table, an instance's
+    //fields) - checked against the limit at the next collection
+    void charge(GcObject* obj, size_t bytes) {
+        obj->gcSize += bytes;
+        bytesAllocated += bytes;
+        HUFF_COUNT_BY(bytes, bytes);
+    }
+
+    //Schedules the next collection as if one had just found everything allocated so far live -
+    //for data known to be reachable (ie: a startup image), which collecting would only re-mark
+    void settle() {
+        nextGC = std::max(threshold, (size_t)(bytesAllocated * growFactor));
+        if (limit != 0) {
+            nextGC = std::min(nextGC, limit);
+        }
+    }
+
+    //Makes room for bytes more of strings - collecting first if they'd go over the limit, as make does
+    //(strings only held by garbage are freed with it)
+    void reserveStrings(size_t bytes) {
+        if (limit != 0 && this->bytes() + bytes > limit) {
+            collect();
+            checkLimit(bytes);
+        }
+    }
+
+    void checkLimit(size_t incoming = 0) {
+        if (limit != 0 && bytes() + incoming > limit) {
+            throw new RuntimeError("Heap limit of " + std::to_string(limit) + " bytes reached", 0);
+        }
+    }
+
+    void collect() {
+        //Mark
+        if (roots != nullptr) {
+            roots->markRoots(*this);
+        }
+        for (const std::any* val : tempRoots) {
+            markValue(*val);
+        }
+        for (GcObject* obj : tempObjects) {
+            mark(obj);
+        }
+
+        //Iterative so deep enviroment chains (recursion) don't blow the c++ stack
+        while (!grey.empty()) {
+            GcObject* obj = grey.back();
+            grey.pop_back();
+            obj->trace(*this);
+        }
+
+        //Sweep
+        size_t live = 0;
+        size_t liveBytes = 0;
+        for (GcObject* o : objects) {
+            if (o->marked) {
+                o->marked = false;
+                objects[live++] = o;
+                liveBytes += o->gcSize;
+            } else {
+                delete o;
+                freed++;
+            }
+        }
+        objects.resize(live);
+
+        bytesAllocated = liveBytes;
+        nextGC = std::max(threshold, (size_t)(liveBytes * growFactor));
+        if (limit != 0) {
+            //Collect before going over, so only live data can trip the limit
+            nextGC = std::min(nextGC, limit);
+        }
+        collections++;
+    }
+};
+
+//Pops any temporary roots pushed during its lifetime, including when unwinding
+class RootScope {
+    Heap& heap;
+    std::pair<size_t, size_t> depth;
+
+    public:
+    RootScope(Heap& heap) : heap(heap) {
+        this->depth = heap.rootDepth();
+    }
+
+    ~RootScope() {
+        heap.restoreRoots(depth);
+    }
+};
@@ -4,15 +4,36 @@
 #include<any>
 #include "expr.hpp"
 #include "utils.hpp"
+#include "numeric.hpp"
+#include "gc.hpp"
+#include "enviroment.hpp"
+#include "error.hpp"
+#include "strsearch.hpp"
+#include "budget.hpp"
+#include "memo.hpp"
 
 class ExprVisitor;
 class StmtVisitor;
+class UDCallable;
 
-class Interpreter : public ExprVisitor, public StmtVisitor {
+class Interpreter : public ExprVisitor, public StmtVisitor, public GcRoots {
     public:
 
+    Heap heap;
     Enviroment* env;
     Enviroment* global;
+    //Enviroments suspended by executeBlock (callers of the running function)
+    std::vector<Enviroment*> frames;
+    //User functions being run, innermost last - captured variables are read through its upvalues
+    std::vector<UDCallable*> calls;
+    //Set by a return statement until the function call it returns from collects returnValue
+    bool returning = false;
+    std::any returnValue;
+    //Execution limits for this interpreter - see budget.hpp
+    Budget budget;
+    //Set on pfor & preduce workers, which share the caller's scopes & objects - they may only
+    //change what they made themselves
+    bool worker = false;
     Interpreter();
     std::any visitPrintStmt(Print* stmt);
     std::any visitVarStmt(Var* stmt);
@@ -22,6 +43,7 @@ class Interpreter : public ExprVisitor, public StmtVisitor {
     std::any visitFunctionStmt(Func* stmt);
     std::any visitExpressionStmt(Expression* stmt);
     std::any visitReturnStmt(Return* stmt);
+    std::any visitImportStmt(Import* stmt);
     std::any visitLiteralExpr(Literal* expr);
     std::any visitGroupingExpr(Grouping* expr);
     std::any visitUnaryExpr(Unary* expr);
@@ -30,44 +52,150 @@ class Interpreter : public ExprVisitor, public StmtVisitor {
     std::any visitAssignmentExpr(Assignment* expr);
     std::any visitVariableExpr(Variable* var);
     std::any visitClassStmt(Class* stmt);
+    std::any visitGetExpr(Get* expr);
+    std::any visitSetExpr(Set* expr);
+    std::any visitThisExpr(This* expr);
+    std::any visitDictExpr(DictLiteral* expr);
+    std::any visitNumBinaryExpr(NumBinary* expr);
+    std::any visitNumUnaryExpr(NumUnary* expr);
     bool isTruthy(std::any expr);
     std::any executeBlock(Block* block, Enviroment* blockEnv);
-    template<typename T> void castValid(int c, ...);
+    //Closure of decl over the running scope - capturing just the variables decl uses
+    UDCallable* closure(Func* decl);
+    std::any* upvalue(int index);
+    template<typename T, typename... Vals> void castValid(const Vals&... vals) {
+        for (const std::any* val : {&vals...}) {
+            if (val->type() != typeid(T)) {
+                throw new CastError(0, val->type().name(), "of type ");
+            }
+        }
+    }
+    //Like castValid, but a number of either kind will do
+    template<typename... Vals> void numberValid(const Vals&... vals) {
+        for (const std::any* val : {&vals...}) {
+            if (val->type() != typeid(HInt) && val->type() != typeid(double)) {
+                throw new CastError(0, val->type().name(), "of type ");
+            }
+        }
+    }
     void interpret(std::vector<Stmt*> stmts);
+    void markRoots(Heap& heap);
+    //Applies budget.limits and starts the clock - interpret() calls this itself
+    void startBudget();
+    //Counts one statement against the budget
+    void step() {
+        if (--budget.ticks == 0) budgetCheck();
+    }
+    void budgetCheck();
+    //Fails when a worker is about to change target, made by another interpreter
+    void mutating(GcObject* target, const std::string& what, int line) {
+        if (worker && target->owner != &heap) {
+            throw new RuntimeError("Parallel function can't change " + what + " - it's shared with the other workers", line);
+        }
+    }
 };
 
-struct HCallable {
+struct HCallable : public GcObject {
     int numArgs;
+    //False for functions & classes declared in huffle
+    bool native = true;
     virtual std::any call(Interpreter* env, std::vector<std::any> args)=0;
 };
 
-class  NestedReturn {
+//Keeps a user function on Interpreter::calls for as long as it runs - recursion deep enough to
+//overflow the c++ stack is an error even with no depth limit set
+class CallFrame {
+    Interpreter* i;
+
     public:
-    std::any val;
+    CallFrame(Interpreter* i, UDCallable* fn) : i(i) {
+        size_t max = i->budget.limits.maxDepth;
+        if (max != 0 && i->calls.size() >= max) {
+            throw new RuntimeError("Call depth limit of " + std::to_string(max) + " reached", 0);
+        }
+        if (huff::stackExhausted()) {
+            throw new RuntimeError("Stack overflow - recursion too deep", 0);
+        }
+        i->calls.push_back(fn);
+    }
 
-    NestedReturn(std::any v) {
-        this->val = v;
+    ~CallFrame() {
+        i->calls.pop_back();
     }
 };
 
+
 class UDCallable : public HCallable {
     public:
     int numArgs;
     Func* declaration;
-    Enviroment* closure;
-    UDCallable(Func* declaration, Enviroment* closure) {
+    Block* body;
+    //Scope the function's globals are looked up in
+    Enviroment* globals;
+    //One per declaration->captures
+    std::vector<Upvalue*> upvalues;
+    //Results so far, for a @memo function
+    std::unique_ptr<MemoCache> memo;
+    UDCallable(Func* declaration, Enviroment* globals) {
         this->declaration = declaration;
-        this->closure = closure;
+        this->globals = globals;
+        this->body = new Block(declaration->body);
+        this->native = false;
+        if (declaration->memo) {
+            this->memo = std::make_unique<MemoCache>(declaration->memoLimit);
+        }
+    }
+
+    ~UDCallable() {
+        delete body;
+    }
+
+    void trace(Heap& heap) {
+        heap.mark(globals);
+        for (Upvalue* up : upvalues) {
+            heap.mark(up);
+        }
     }
 
     std::any call(Interpreter* i, std::vector<std::any> args) {
+        if (memo != nullptr) {
+            return cached(i, args);
+        }
+        return invoke(i, args, std::any());
+    }
+
+    //Call of a @memo function - only runs when the arguments haven't been seen (or can't be cached)
+    std::any cached(Interpreter* i, std::vector<std::any>& args) {
+        std::string key;
+        std::any result;
+        if (!MemoCache::key(args, key)) {
+            return invoke(i, args, std::any());
+        }
+        if (memo->find(key, result)) {
+            return result;
+        }
+
+        result = invoke(i, args, std::any());
+        if (MemoCache::cacheable(result)) {
+            size_t grew = memo->insert(key, result);
+            //pfor workers share the function but not its heap
+            if (&i->heap == owner) {
+                i->heap.charge(this, grew);
+            }
+        }
+        return result;
+    }
+
+    //Runs the function with 'this' bound to self (when self has a value)
+    std::any invoke(Interpreter* i, std::vector<std::any>& args, const std::any& self) {
         //Steps:
 
-        //Currently every time a function is executed, we use the the current enviroment - this of course changes, and so function calls may work
-        //in some situations, but not in ones where the enviroment is diferent to where it was located - so we will capture the enviroment where the function
-        //is declared to ensure it runs consistently...
+        //Variables from enclosing scopes come from the function's upvalues (see closures.hpp), so the
+        //function's scope only needs to enclose the globals
 
-        Enviroment* funcEnv = new Enviroment(true, this->closure);
+        CallFrame frame(i, this);
+        HUFF_COUNT(userCalls);
+        Enviroment* funcEnv = i->heap.make<Enviroment>(true, this->globals);
         if (args.size() == this->declaration->params.size()) {
             for (int x= 0; x<args.size(); x++) {
                 funcEnv->define(this->declaration->params[x], args[x]);
@@ -75,12 +203,18 @@ class UDCallable : public HCallable {
         } else { 
             throw new RuntimeError("Invalid argument count for function: " + this->declaration->name.lexeme,0); 
         }
+        if (self.has_value()) {
+            funcEnv->define("this", self);
+        }
 
-        try {
-            return i->executeBlock(new Block(this->declaration->body), funcEnv);
-        } catch (NestedReturn* e) {
-            return e->val;
-        }  
+        i->executeBlock(this->body, funcEnv);
+        if (i->returning) {
+            i->returning = false;
+            std::any val = std::move(i->returnValue);
+            i->returnValue.reset();
+            return val;
+        }
+        return std::any();
         // Create new enviroment for funciton scope
         //Loop thorugh args and define in new enviroment - args are literals, use func body for names;
         //Execute block with new env
@@ -95,30 +229,40 @@ class in : public HCallable {
         std::cout << huff::anyToString(args[0]);
         std::string result;
         std::getline(std::cin, result);
-        return result;
+        return HString(result);
     }
 }; 
 
+//Strings holding a whole number give an integer, any other number a double
 class toNum : public HCallable {
     public:
     int numArgs=1;
 
     std::any call(Interpreter* i, std::vector<std::any> args) {
-        try {
-            return std::stod(std::any_cast<std::string>(args[0]));
-        } catch (std::invalid_argument& e) {
-            throw new RuntimeError("Can't convert to int - Invalid string",0);
-        } catch (std::bad_any_cast& e) {
+        if (const HString* str = std::any_cast<HString>(&args[0])) {
+            std::string text = str->str();
             try {
-                return std::any_cast<double>(args[0]);
-            } catch (std::bad_any_cast& e) {
+                size_t used;
+                if (text.find_first_of(".eEnN") == std::string::npos) {
+                    HInt val = std::stoll(text, &used);
+                    if (used == text.size()) return val;
+                }
+                return std::stod(text);
+            } catch (std::invalid_argument& e) {
+                throw new RuntimeError("Can't convert to number - Invalid string",0);
+            } catch (std::out_of_range& e) {
                 try {
-                    return double(std::any_cast<bool>(args[0]));
-                } catch (std::bad_any_cast& e) {
-                    throw new RuntimeError("Unable to convert arg type to int",0);
+                    return std::stod(text);
+                } catch (std::out_of_range& e) {
+                    throw new RuntimeError("Can't convert to number - Out of range",0);
                 }
             }
+        } else if (huff::isNumber(args[0])) {
+            return args[0];
+        } else if (const bool* b = std::any_cast<bool>(&args[0])) {
+            return HInt(*b);
         }
+        throw new RuntimeError("Unable to convert arg type to number",0);
     }
 };
 
@@ -127,21 +271,14 @@ class toStr : public HCallable {
     int numArgs=1;
 
     std::any call(Interpreter* i, std::vector<std::any> args) {
-        try {
-            return std::to_string(std::any_cast<double>(args[0]));
-        } catch (std::invalid_argument& e) {
-            throw new RuntimeError("Can't convert to string - Invalid arg",0);
-        } catch (std::bad_any_cast& e) {
-            try {
-                return std::any_cast<std::string>(args[0]);
-            } catch (std::bad_any_cast& e) {
-                try {
-                    return std::any_cast<bool>(args[0])==true ? true : false;
-                } catch (std::bad_any_cast& e) {
-                    throw new RuntimeError("Unable to convert arg type to string",0);
-                }
-            }
+        if (huff::isNumber(args[0])) {
+            return HString(huff::anyToString(args[0]));
+        } else if (args[0].type() == typeid(HString)) {
+            return args[0];
+        } else if (const bool* b = std::any_cast<bool>(&args[0])) {
+            return *b;
         }
+        throw new RuntimeError("Unable to convert arg type to string",0);
     }
 };
 
@@ -160,7 +297,7 @@ class length : public HCallable {
 
     std::any call(Interpreter* i, std::vector<std::any> args) {
         try {
-            return (double)std::any_cast<std::string>(args[0]).length();
+            return (HInt)std::any_cast<HString&>(args[0]).size();
         } catch (std::bad_any_cast& e ) {
             throw new RuntimeError("Can't get length of non-string",0);
         }
@@ -172,7 +309,7 @@ class type : public HCallable {
     int numArgs=1;
 
     std::any call(Interpreter* i, std::vector<std::any> args) {
-        return std::string(args[0].type().name());
+        return HString(args[0].type().name());
     }
 };
 
@@ -182,7 +319,7 @@ class contains : public HCallable {
 
     std::any call(Interpreter* i, std::vector<std::any> args) {
         try {
-            return std::any_cast<std::string>(args[0]).find(std::any_cast<std::string>(args[1])) != std::string::npos;
+            return huff::search::find(std::any_cast<HString&>(args[0]).view(), std::any_cast<HString&>(args[1]).view()) != huff::search::npos;
         } catch (std::bad_any_cast& e ) {
             throw new RuntimeError("Can't use contains() on non-string",0);
         }
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <ostream>
+#include <algorithm>
+
+//Bytes held by the string buffers one heap has made or grown - each buffer keeps a reference, so
+//it can give its bytes back after the heap is gone (ie: a string handed to another thread)
+struct StrMeter {
+    std::atomic<size_t> bytes{0};
+};
+
+//Shared character buffer behind one or more strings
+struct StrBuf {
+    std::string data;
+    //Frozen buffers are never appended to in place (ie: literals from the source)
+    bool frozen = false;
+    //Set when the bytes live outside data (ie: a memory mapped file) - always frozen
+    const char* external = nullptr;
+
+    //Above zero while parallel workers may be reading any buffer (see pfor) - nothing is
+    //appended in place until they finish
+    static inline std::atomic<int> sharing{0};
+
+    //Meter data's capacity is counted against (nullptr if nothing counts it) & how much is counted
+    std::shared_ptr<StrMeter> meter;
+    size_t metered = 0;
+
+    virtual ~StrBuf() {
+        if (meter != nullptr) meter->bytes.fetch_sub(metered, std::memory_order_relaxed);
+    }
+
+    //Counts data's capacity - a buffer nothing counts yet is taken on by the meter given
+    void charge(const std::shared_ptr<StrMeter>& by) {
+        if (meter == nullptr) meter = by;
+        if (meter == nullptr) return;
+        size_t now = data.capacity();
+        meter->bytes.fetch_add(now - metered, std::memory_order_relaxed);
+        metered = now;
+    }
+
+    const char* bytes() const {
+        return external != nullptr ? external : data.data();
+    }
+};
+
+//Immutable Huffle string value - a view (off, len) into a shared buffer
+//Strings never see bytes past their own length, so when a string ends exactly
+//at the end of its buffer, concatenation can append to the buffer in place and
+//hand back a longer view of it: s = s + line is amortized O(1) rather than a copy
+//
+//The view itself is reference counted & a string is one pointer to it, so it fits inside a
+//std::any without an allocation - copying a string (loading a variable or literal, passing an
+//argument) just bumps the count, and only making a new string allocates
+class HString {
+    struct View {
+        std::shared_ptr<StrBuf> buf;
+        size_t off;
+        size_t len;
+        std::atomic<size_t> refs{1};
+    };
+
+    //nullptr for the empty string
+    View* v = nullptr;
+
+    void release() {
+        if (v != nullptr && v->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete v;
+        }
+    }
+
+    public:
+    HString() = default;
+
+    //View of part of an existing buffer
+    HString(std::shared_ptr<StrBuf> buf, size_t off, size_t len) {
+        if (len != 0) {
+            this->v = new View{std::move(buf), off, len};
+        }
+    }
+
+    HString(std::string str, bool frozen = false) {
+        if (str.empty()) return;
+        auto buf = std::make_shared<StrBuf>();
+        buf->data = std::move(str);
+        buf->frozen = frozen;
+        size_t len = buf->data.size();
+        this->v = new View{std::move(buf), 0, len};
+    }
+
+    HString(const char* str) : HString(std::string(str)) {}
+
+    HString(const HString& other) noexcept : v(other.v) {
+        if (v != nullptr) v->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    HString(HString&& other) noexcept : v(other.v) {
+        other.v = nullptr;
+    }
+
+    HString& operator=(const HString& other) noexcept {
+        if (other.v != nullptr) other.v->refs.fetch_add(1, std::memory_order_relaxed);
+        release();
+        v = other.v;
+        return *this;
+    }
+
+    HString& operator=(HString&& other) noexcept {
+        if (this != &other) {
+            release();
+            v = other.v;
+            other.v = nullptr;
+        }
+        return *this;
+    }
+
+    ~HString() {
+        release();
+    }
+
+    std::string_view view() const {
+        if (v == nullptr) return std::string_view();
+        return std::string_view(v->buf->bytes() + v->off, v->len);
+    }
+
+    size_t size() const {
+        return v == nullptr ? 0 : v->len;
+    }
+
+    std::string str() const {
+        return std::string(view());
+    }
+
+    //Substring sharing this string's buffer
+    HString slice(size_t from, size_t count) const {
+        if (v == nullptr) return HString();
+        return HString(v->buf, v->off + from, count);
+    }
+
+    //Whether concat can append to left's buffer in place
+    static bool appendable(const View& l) {
+        return !l.buf->frozen && l.off + l.len == l.buf->data.size()
+            && StrBuf::sharing.load(std::memory_order_relaxed) == 0;
+    }
+
+    //Capacity an in-place append grows a buffer to - doubled, so appends stay amortized O(1)
+    static size_t grown(const StrBuf& buf, size_t adding) {
+        size_t wanted = buf.data.size() + adding;
+        return wanted <= buf.data.capacity() ? buf.data.capacity() : std::max(wanted, buf.data.capacity() * 2);
+    }
+
+    //Bytes concat(left, right) will allocate - so they can be checked against a heap limit first
+    static size_t growth(const HString& left, const HString& right) {
+        if (left.v == nullptr || right.v == nullptr) return 0;
+        if (appendable(*left.v)) {
+            return grown(*left.v->buf, right.v->len) - left.v->buf->data.capacity();
+        }
+        return left.v->len + right.v->len;
+    }
+
+    //Both the buffer grown in place & a new buffer are charged to meter
+    static HString concat(const HString& left, const HString& right, const std::shared_ptr<StrMeter>& meter) {
+        if (right.v == nullptr) return left;
+        if (left.v == nullptr) return right;
+
+        const View& l = *left.v;
+        if (appendable(l)) {
+            l.buf->data.reserve(grown(*l.buf, right.v->len));
+            if (right.v->buf == l.buf) {
+                //Appending a view of the same buffer - copy first, the append may reallocate
+                std::string copy(right.view());
+                l.buf->data.append(copy);
+            } else {
+                l.buf->data.append(right.view());
+            }
+            l.buf->charge(meter);
+            return HString(l.buf, l.off, l.len + right.v->len);
+        }
+
+        auto joined = std::make_shared<StrBuf>();
+        joined->data.reserve(l.len + right.v->len);
+        joined->data.append(left.view());
+        joined->data.append(right.view());
+        joined->charge(meter);
+        size_t len = joined->data.size();
+        return HString(std::move(joined), 0, len);
+    }
+
+    //Stops any string sharing this buffer appending to it in place - done before a
+    //string is handed to another thread, so the bytes it can see never change
+    void freeze() const {
+        if (v != nullptr) v->buf->frozen = true;
+    }
+
+    //Copies of one string (ie: a variable holding a literal, compared with that literal -
+    //the scanner hands out one string per distinct literal) match without reading the bytes
+    bool operator==(const HString& other) const {
+        if (v == other.v) return true;
+        if (size() != other.size()) return false;
+        if (v->buf == other.v->buf && v->off == other.v->off) return true;
+        return view() == other.view();
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const HString& s) {
+    return os << s.view();
+}
@@ -2,41 +2,119 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <cstring>
 #include "parser.hpp"
 #include "scanner.hpp"
 #include "types.hpp"
 #include "token.hpp"
 #include "visitor.hpp"
 #include "error.hpp"
+#include "interpreter.hpp"
+#include "astwalk.hpp"
+#include "typeinfer.hpp"
+#include "closures.hpp"
+#include "modules.hpp"
+#include "memo.hpp"
+#include "snapshot.hpp"
 #include <fstream>
+#include <algorithm>
 
 
 bool hadErr = false;
 
-void lrun(std::string l){
-	Scanner p = Scanner(l);
-	std::vector<Stmt*> e;
-	try {
-		
-		std::vector<Token> tokens = p.scan();
-		tokens.push_back(Token(EF,"",'\0',0));
+size_t gcThreshold = 1024 * 1024;
+bool gcStress = false;
+bool dumpTypes = false;
+std::string snapshotPath;
+Limits limits;
+
+void setTaskThreads(unsigned threads) {
+	huff::setPoolThreads(threads);
+}
 
-		Parser p = Parser(tokens);
-		e = p.parse();
+std::vector<Stmt*> parseSource(const std::string& src, std::vector<Err*>& errors) {
+	Scanner scanner = Scanner(src);
+	std::vector<Token> tokens;
+	{
+		HUFF_TIMER(scanNs);
+		tokens = scanner.scan();
+	}
+	tokens.push_back(Token(EF,"",'\0',0));
+	errors = std::move(scanner.errs());
+
+	//Parse even after scan errors, so the one pass reports everything it can
+	Parser parser = Parser(std::move(tokens));
+	std::vector<Stmt*> stmts;
+	{
+		HUFF_TIMER(parseNs);
+		stmts = parser.parse();
+	}
+	errors.insert(errors.end(), parser.errs().begin(), parser.errs().end());
+	std::stable_sort(errors.begin(), errors.end(), [](Err* a, Err* b) { return a->line < b->line; });
+	return stmts;
+}
 
-		//AstPrinter printer = AstPrinter();
-		//std::cout << printer.print(e) << std::endl;
+void lrun(std::string l, const std::string& dir){
+	std::vector<Err*> errors;
+	std::vector<Stmt*> e = parseSource(l, errors);
+
+	if (!errors.empty()) {
+		for (Err* err : errors) {
+			err->msg();
+			delete err;
+		}
+		hadErr = true;
+		huff::freeAst(e);
+		return;
+	}
+
+	huff::resolveImports(e, dir);
+	huff::resolveClosures(e);
+	for (Warning& warning : huff::checkMemo(e)) {
+		warning.msg();
+	}
+	std::vector<TypeRegion> types = huff::inferTypes(e);
+	if (dumpTypes) {
+		huff::dumpTypes(types, std::cout);
+		huff::cancelPrefetch();
+		huff::freeAst(e);
+		return;
+	}
+
+	HUFF_TIMER(runNs);
+	try {
+	Interpreter eval = Interpreter();
+	eval.heap.setThreshold(gcThreshold);
+	eval.heap.stress = gcStress;
+	eval.budget.limits = limits;
+	if (snapshotPath.empty()) {
+		eval.interpret(e);
+	} else {
+		size_t setup = huff::setupLength(e);
+		eval.interpret(std::vector<Stmt*>(e.begin(), e.begin() + setup));
+		huff::writeSnapshot(&eval, std::vector<Stmt*>(e.begin() + setup, e.end()), snapshotPath);
+	}
 	} catch (Err* err) {
 		err->msg();
-		hadErr = true;
-	};	
+		delete err;
+	}
+	huff::cancelPrefetch();
+}
 
+void runSnapshot(const std::string& image) {
+	HUFF_TIMER(runNs);
 	try {
 	Interpreter eval = Interpreter();
-	eval.interpret(e);
+	eval.heap.setThreshold(gcThreshold);
+	eval.heap.stress = gcStress;
+	eval.budget.limits = limits;
+	std::vector<Stmt*> rest = huff::readSnapshot(&eval, image);
+	eval.interpret(rest);
 	} catch (Err* err) {
 		err->msg();
+		delete err;
 	}
+	huff::cancelPrefetch();
 }
 
 void runFile(char* path) {
@@ -44,14 +122,5 @@ void runFile(char* path) {
 
 	std::stringstream buffer;
 	buffer << input.rdbuf();
-	lrun(buffer.str());
-}
-
-int main(int argc, char* argv[]) {
-	if (argc == 2){
-		 runFile(argv[1]);
-	} else {
-		std::cout << "Huff Usage: ./a.out [filename].huff" << std::endl;
-	}
-	return 0;
+	lrun(buffer.str(), std::filesystem::path(path).parent_path().string());
 }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "budget.hpp"
+
+struct Stmt;
+class Err;
+
+extern bool hadErr;
+
+//Collector settings, set from the command line
+extern size_t gcThreshold;
+extern bool gcStress;
+
+//Execution limits for the program, set from the command line
+extern Limits limits;
+
+//Print what type inference proved about each function & loop instead of running the program
+extern bool dumpTypes;
+
+//Image to write the program's globals to once its setup has run, instead of running the rest
+//(see snapshot.hpp) - empty to run normally
+extern std::string snapshotPath;
+
+//Worker threads for spawn() - defaults to one per core
+void setTaskThreads(unsigned threads);
+
+//Scans & parses a program, gathering every error rather than stopping at the first
+std::vector<Stmt*> parseSource(const std::string& src, std::vector<Err*>& errors);
+
+//Runs a program - imports are found relative to dir (the program file's directory)
+void lrun(std::string l, const std::string& dir = ".");
+void runFile(char* path);
+
+//Runs the program saved in a startup image by --snapshot, from where its setup left off
+void runSnapshot(const std::string& image);
+
+//Scans & parses every .huff file under the given paths in parallel without running them
+//Prints each file's errors then a summary - returns the process exit status
+int checkPaths(const std::vector<std::string>& paths, unsigned jobs);
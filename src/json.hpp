@@ -0,0 +1,591 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include <string_view>
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define HUFF_JSON_SSE2 1
+#endif
+#include "hcall.hpp"
+#include "hstring.hpp"
+#include "strings.hpp"
+
+//JSON documents - jsonParse(text) indexes a document once, then jsonGet & jsonCount answer path
+//queries ("a.b.0") against the index without copying or allocating
+//
+//Parsing is two passes over the bytes. The first finds every structural character ({}[]:,),
+//string quote & scalar start 64 bytes at a time using bit masks (SSE2 compares, with a portable
+//version for other cpus) - which bytes are inside strings comes from a prefix xor of the quote
+//mask, so string contents are never looked at byte by byte. The second walks just those
+//positions, checking the grammar and writing the tape - one node per value, where containers
+//record where they end so lookups can skip whole subtrees.
+namespace huff::json {
+    enum NodeType : uint8_t { J_OBJECT, J_ARRAY, J_STRING, J_NUMBER, J_TRUE, J_FALSE, J_NULL };
+
+    struct Node {
+        //Offset into the text - strings start after their opening quote
+        uint32_t start;
+        //Bytes of the value (a string's raw, escaped bytes without its quotes)
+        uint32_t len;
+        //Index of the node after this one's subtree
+        uint32_t next;
+        NodeType type;
+        //A string holding escapes, which has to be decoded to use
+        bool escaped;
+    };
+
+    //Positions of the structural characters, quotes & scalar starts in text
+    //Each block of 64 bytes is reduced to bit masks, one bit per byte
+    struct Masks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t structural;
+        //{ & [
+        uint64_t opening;
+        uint64_t whitespace;
+    };
+
+    inline Masks masksScalar(const char* p) {
+        Masks m = {0, 0, 0, 0, 0};
+        for (int b = 0; b < 64; b++) {
+            uint64_t bit = 1ULL << b;
+            switch (p[b]) {
+                case '"': m.quote |= bit; break;
+                case '\\': m.backslash |= bit; break;
+                case '{': case '[': m.structural |= bit; m.opening |= bit; break;
+                case '}': case ']': case ':': case ',': m.structural |= bit; break;
+                case ' ': case '\t': case '\n': case '\r': m.whitespace |= bit; break;
+            }
+        }
+        return m;
+    }
+
+#ifdef HUFF_JSON_SSE2
+    inline Masks masksSSE2(const char* p) {
+        Masks m = {0, 0, 0, 0, 0};
+        for (int part = 0; part < 4; part++) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(p + part * 16));
+            auto eq = [&](char c) { return _mm_cmpeq_epi8(block, _mm_set1_epi8(c)); };
+            //[ & ] are { & } with bit 5 clear
+            __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+            __m128i opening = _mm_cmpeq_epi8(folded, _mm_set1_epi8('{'));
+            __m128i structural = _mm_or_si128(_mm_or_si128(opening, _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                _mm_or_si128(eq(':'), eq(',')));
+            __m128i whitespace = _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r')));
+            int shift = part * 16;
+            m.quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(eq('"')) << shift;
+            m.backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(eq('\\')) << shift;
+            m.structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural) << shift;
+            m.opening |= (uint64_t)(uint16_t)_mm_movemask_epi8(opening) << shift;
+            m.whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(whitespace) << shift;
+        }
+        return m;
+    }
+#endif
+
+    inline Masks masks(const char* p) {
+#ifdef HUFF_JSON_SSE2
+        return masksSSE2(p);
+#else
+        return masksScalar(p);
+#endif
+    }
+
+    //Bit i set when an odd number of bits at or below i are
+    inline uint64_t prefixXor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    //Bytes that follow an unescaped backslash - carry is whether the last block ended in one
+    inline uint64_t escapedBytes(uint64_t backslash, bool& carry) {
+        uint64_t escaped = carry ? 1 : 0;
+        carry = false;
+        backslash &= ~escaped;
+        while (backslash != 0) {
+            int at = __builtin_ctzll(backslash);
+            backslash &= backslash - 1;
+            if (at == 63) {
+                carry = true;
+                break;
+            }
+            escaped |= 1ULL << (at + 1);
+            //An escaped backslash doesn't start an escape of its own
+            backslash &= ~escaped;
+        }
+        return escaped;
+    }
+
+    //Positions found by pass one - grown without initialising, as every slot is written before use
+    struct Positions {
+        std::unique_ptr<uint32_t[]> at;
+        size_t capacity = 0;
+        size_t size = 0;
+        //Tape nodes they'll make (strings, scalars & containers)
+        size_t nodes = 0;
+
+        void reserve(size_t n) {
+            if (n <= capacity) return;
+            size_t grown = std::max(n, capacity * 2);
+            std::unique_ptr<uint32_t[]> bigger(new uint32_t[grown]);
+            if (size != 0) memcpy(bigger.get(), at.get(), size * sizeof(uint32_t));
+            at = std::move(bigger);
+            capacity = grown;
+        }
+    };
+
+    //Pass one - appends the position of every byte pass two needs to see, returns false if a
+    //string is left open. Scalar starts are the first byte of a run outside strings that isn't
+    //whitespace or structural; closing quotes & the backslashes of escapes are kept so strings
+    //needn't be rescanned for their end, or to see if they need decoding
+    inline bool index(std::string_view text, Positions& out) {
+        bool inString = false;
+        bool escapeCarry = false;
+        //Whether the byte before the block was part of a scalar
+        bool scalarCarry = false;
+        char tail[64];
+        //Most documents have a position every 3-4 bytes
+        out.reserve(out.size + text.size() / 3 + 64);
+        for (size_t at = 0; at < text.size(); at += 64) {
+            const char* block = text.data() + at;
+            if (text.size() - at < 64) {
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, block, text.size() - at);
+                block = tail;
+            }
+            Masks m = masks(block);
+
+            uint64_t escaped = (m.backslash != 0 || escapeCarry) ? escapedBytes(m.backslash, escapeCarry) : 0;
+            uint64_t quotes = m.quote & ~escaped;
+            //Set from an opening quote up to (not including) its closing quote
+            uint64_t strings = prefixXor(quotes) ^ (inString ? ~0ULL : 0);
+            inString = (strings >> 63) != 0;
+
+            uint64_t scalar = ~(m.structural | m.whitespace | quotes | strings);
+            uint64_t scalarStarts = scalar & ~((scalar << 1) | (scalarCarry ? 1 : 0));
+            scalarCarry = (scalar >> 63) != 0;
+
+            uint64_t wanted = (m.structural & ~strings) | quotes | scalarStarts | (m.backslash & ~escaped & strings);
+            out.nodes += __builtin_popcountll((quotes & strings) | scalarStarts | (m.opening & ~strings));
+            //Written four at a time without checking for the end, so there are no hard to predict
+            //branches per position - writes past the block's count land in slack & are overwritten
+            out.reserve(out.size + 64);
+            uint32_t* to = out.at.get() + out.size;
+            int count = __builtin_popcountll(wanted);
+            for (int n = 0; n < count; n += 4) {
+                //Bit 63 keeps ctz defined once wanted runs out
+                to[n] = at + __builtin_ctzll(wanted | (1ULL << 63));
+                wanted &= wanted - 1;
+                to[n + 1] = at + __builtin_ctzll(wanted | (1ULL << 63));
+                wanted &= wanted - 1;
+                to[n + 2] = at + __builtin_ctzll(wanted | (1ULL << 63));
+                wanted &= wanted - 1;
+                to[n + 3] = at + __builtin_ctzll(wanted | (1ULL << 63));
+                wanted &= wanted - 1;
+            }
+            out.size += count;
+        }
+        return !inString;
+    }
+
+    //Value of the 4 hex digits at raw[from], or -1 if there aren't 4
+    inline long hexQuad(std::string_view raw, size_t from) {
+        if (from + 4 > raw.size()) return -1;
+        long code = 0;
+        for (size_t h = from; h < from + 4; h++) {
+            char c = raw[h];
+            int digit = c >= '0' && c <= '9' ? c - '0' : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10 : -1;
+            if (digit < 0) return -1;
+            code = code * 16 + digit;
+        }
+        return code;
+    }
+
+    //Code point of the \u escape whose 'u' is at raw[n] - a high surrogate takes the \u escape of
+    //its low half with it. n is left on the escape's last digit; -1 for a truncated or invalid
+    //escape, or an unpaired surrogate
+    inline long codePoint(std::string_view raw, size_t& n) {
+        long code = hexQuad(raw, n + 1);
+        if (code < 0 || (code >= 0xDC00 && code < 0xE000)) return -1;
+        n += 4;
+        if (code < 0xD800 || code >= 0xDC00) return code;
+        if (n + 2 >= raw.size() || raw[n + 1] != '\\' || raw[n + 2] != 'u') return -1;
+        long low = hexQuad(raw, n + 3);
+        if (low < 0xDC00 || low >= 0xE000) return -1;
+        n += 6;
+        return 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    //Writes the JSON string escape decoding of raw into out
+    inline bool unescape(std::string_view raw, std::string& out) {
+        out.reserve(raw.size());
+        for (size_t n = 0; n < raw.size(); n++) {
+            if (raw[n] != '\\') {
+                out += raw[n];
+                continue;
+            }
+            if (++n == raw.size()) return false;
+            switch (raw[n]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    long code = codePoint(raw, n);
+                    if (code < 0) return false;
+                    //UTF-8
+                    if (code < 0x80) {
+                        out += (char)code;
+                    } else if (code < 0x800) {
+                        out += (char)(0xC0 | (code >> 6));
+                        out += (char)(0x80 | (code & 0x3F));
+                    } else if (code < 0x10000) {
+                        out += (char)(0xE0 | (code >> 12));
+                        out += (char)(0x80 | ((code >> 6) & 0x3F));
+                        out += (char)(0x80 | (code & 0x3F));
+                    } else {
+                        out += (char)(0xF0 | (code >> 18));
+                        out += (char)(0x80 | ((code >> 12) & 0x3F));
+                        out += (char)(0x80 | ((code >> 6) & 0x3F));
+                        out += (char)(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return true;
+    }
+
+    //Whether unescape() would accept raw, checked without decoding it
+    inline bool validEscapes(std::string_view raw) {
+        for (size_t n = raw.find('\\'); n != std::string_view::npos; n = raw.find('\\', n + 1)) {
+            if (++n == raw.size()) return false;
+            switch (raw[n]) {
+                case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': break;
+                case 'u':
+                    if (codePoint(raw, n) < 0) return false;
+                    break;
+                default: return false;
+            }
+        }
+        return true;
+    }
+
+    //-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    inline bool validNumber(std::string_view s) {
+        size_t n = 0;
+        auto digits = [&]() {
+            size_t from = n;
+            while (n < s.size() && s[n] >= '0' && s[n] <= '9') n++;
+            return n > from;
+        };
+        if (n < s.size() && s[n] == '-') n++;
+        if (n < s.size() && s[n] == '0') {
+            n++;
+        } else if (!digits()) {
+            return false;
+        }
+        if (n < s.size() && s[n] == '.') {
+            n++;
+            if (!digits()) return false;
+        }
+        if (n < s.size() && (s[n] == 'e' || s[n] == 'E')) {
+            n++;
+            if (n < s.size() && (s[n] == '+' || s[n] == '-')) n++;
+            if (!digits()) return false;
+        }
+        return n == s.size();
+    }
+}
+
+//Parsed JSON document - the text it was parsed from (shared, not copied) and its tape
+class JsonDoc : public GcObject {
+    public:
+    HString text;
+    std::vector<huff::json::Node> tape;
+
+    JsonDoc(HString text) {
+        this->text = std::move(text);
+        //Values handed out are views of the text, which may cross threads
+        this->text.freeze();
+    }
+
+    void trace(Heap&) {}
+
+    //Pass two - builds the tape from the positions pass one found
+    void parse() {
+        using namespace huff::json;
+        std::string_view src = text.view();
+        if (src.size() >= UINT32_MAX) {
+            fail("document is over 4GB", 0);
+        }
+
+        //Reused between calls, so parsing many small documents doesn't allocate each time
+        thread_local Positions positions;
+        thread_local std::vector<uint32_t> open;
+        positions.size = 0;
+        positions.nodes = 0;
+        open.clear();
+        if (!index(src, positions)) {
+            fail("unterminated string", src.size());
+        }
+        tape.reserve(positions.nodes);
+
+        //What may come next - a value, an object key, a ':' or a ','/close
+        enum Expect { VALUE, KEY, KEY_OR_CLOSE, VALUE_OR_CLOSE, COLON, COMMA_OR_CLOSE, DONE };
+        Expect expect = VALUE;
+        auto valueDone = [&]() {
+            expect = open.empty() ? DONE : COMMA_OR_CLOSE;
+        };
+        auto delimiter = [](char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '{' || c == '}' || c == '['
+                || c == ']' || c == ':' || c == ',' || c == '"';
+        };
+
+        for (size_t p = 0; p < positions.size; p++) {
+            uint32_t at = positions.at[p];
+            char c = src[at];
+            bool inObject = !open.empty() && tape[open.back()].type == J_OBJECT;
+            switch (c) {
+                case '{':
+                case '[':
+                    if (expect != VALUE && expect != VALUE_OR_CLOSE) fail("unexpected '" + std::string(1, c) + "'", at);
+                    open.push_back(tape.size());
+                    tape.push_back(Node{at, 0, 0, c == '{' ? J_OBJECT : J_ARRAY, false});
+                    expect = c == '{' ? KEY_OR_CLOSE : VALUE_OR_CLOSE;
+                    break;
+                case '}':
+                case ']': {
+                    bool object = c == '}';
+                    if (open.empty() || inObject != object) fail("unexpected '" + std::string(1, c) + "'", at);
+                    if (expect != COMMA_OR_CLOSE && expect != (object ? KEY_OR_CLOSE : VALUE_OR_CLOSE)) {
+                        fail("unexpected '" + std::string(1, c) + "'", at);
+                    }
+                    Node& container = tape[open.back()];
+                    container.next = tape.size();
+                    container.len = at + 1 - container.start;
+                    open.pop_back();
+                    valueDone();
+                    break;
+                }
+                case ':':
+                    if (expect != COLON) fail("unexpected ':'", at);
+                    expect = VALUE;
+                    break;
+                case ',':
+                    if (expect != COMMA_OR_CLOSE) fail("unexpected ','", at);
+                    expect = inObject ? KEY : VALUE;
+                    break;
+                case '"': {
+                    //Its closing quote is the next position after any escapes
+                    bool escaped = false;
+                    while (++p < positions.size && src[positions.at[p]] == '\\') {
+                        escaped = true;
+                    }
+                    if (p == positions.size) fail("unterminated string", at);
+                    uint32_t end = positions.at[p];
+                    if (escaped && !validEscapes(src.substr(at + 1, end - at - 1))) {
+                        fail("invalid escape in string", at);
+                    }
+                    tape.push_back(Node{at + 1, end - at - 1, (uint32_t)tape.size() + 1, J_STRING, escaped});
+                    if (expect == KEY || expect == KEY_OR_CLOSE) {
+                        expect = COLON;
+                    } else if (expect == VALUE || expect == VALUE_OR_CLOSE) {
+                        valueDone();
+                    } else {
+                        fail("unexpected string", at);
+                    }
+                    break;
+                }
+                default: {
+                    if (expect != VALUE && expect != VALUE_OR_CLOSE) fail("unexpected '" + std::string(1, c) + "'", at);
+                    uint32_t end = at;
+                    while (end < src.size() && !delimiter(src[end])) end++;
+                    std::string_view word = src.substr(at, end - at);
+                    NodeType type;
+                    if (word == "true") {
+                        type = J_TRUE;
+                    } else if (word == "false") {
+                        type = J_FALSE;
+                    } else if (word == "null") {
+                        type = J_NULL;
+                    } else if (validNumber(word)) {
+                        type = J_NUMBER;
+                    } else {
+                        fail("invalid value '" + std::string(word) + "'", at);
+                    }
+                    tape.push_back(Node{at, end - at, (uint32_t)tape.size() + 1, type, false});
+                    valueDone();
+                }
+            }
+        }
+
+        if (expect != DONE) {
+            fail(tape.empty() ? "empty document" : "document ends early", src.size());
+        }
+        //Only small buffers are kept for the next document
+        if (positions.capacity > (1 << 20)) {
+            positions = Positions();
+        }
+    }
+
+    //Entries of the object or array at index
+    uint32_t count(uint32_t index) const {
+        using namespace huff::json;
+        const Node& container = tape[index];
+        uint32_t entries = 0;
+        for (uint32_t at = index + 1; at < container.next; entries++) {
+            at = container.type == J_OBJECT ? tape[at + 1].next : tape[at].next;
+        }
+        return entries;
+    }
+
+    //Tape index of the value at path (keys & array indexes separated by '.'), or -1
+    long find(std::string_view path) const {
+        using namespace huff::json;
+        std::string_view src = text.view();
+        uint32_t node = 0;
+        while (!path.empty()) {
+            size_t dot = path.find('.');
+            std::string_view part = path.substr(0, dot);
+            path = dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+
+            const Node& container = tape[node];
+            uint32_t at = node + 1;
+            if (container.type == J_OBJECT) {
+                //Entries are a key node then the value's subtree
+                while (at < container.next && !keyMatches(src, tape[at], part)) {
+                    at = tape[at + 1].next;
+                }
+                if (at == container.next) return -1;
+                node = at + 1;
+            } else if (container.type == J_ARRAY) {
+                uint32_t index;
+                auto [end, err] = std::from_chars(part.data(), part.data() + part.size(), index);
+                if (err != std::errc() || end != part.data() + part.size()) return -1;
+                for (; index > 0 && at < container.next; index--) {
+                    at = tape[at].next;
+                }
+                if (at == container.next) return -1;
+                node = at;
+            } else {
+                return -1;
+            }
+        }
+        return node;
+    }
+
+    //Huffle value of the node at index - strings are views of the text unless they hold escapes,
+    //objects & arrays come back as their JSON text
+    std::any value(uint32_t index) const {
+        using namespace huff::json;
+        const Node& node = tape[index];
+        switch (node.type) {
+            case J_STRING: {
+                if (!node.escaped) {
+                    return text.slice(node.start, node.len);
+                }
+                std::string decoded;
+                unescape(text.view().substr(node.start, node.len), decoded);
+                return HString(std::move(decoded));
+            }
+            case J_NUMBER: {
+                const char* from = text.view().data() + node.start;
+                const char* to = from + node.len;
+                HInt i;
+                auto [end, err] = std::from_chars(from, to, i);
+                if (err == std::errc() && end == to) return i;
+                double d;
+                std::from_chars(from, to, d);
+                return d;
+            }
+            case J_TRUE: return true;
+            case J_FALSE: return false;
+            case J_NULL: return NULL;
+            default: return text.slice(node.start, node.len);
+        }
+    }
+
+    private:
+    static bool keyMatches(std::string_view src, const huff::json::Node& key, std::string_view name) {
+        std::string_view raw = src.substr(key.start, key.len);
+        if (!key.escaped) return raw == name;
+        //Escaped keys (rare) are decoded to compare
+        std::string decoded;
+        return huff::json::unescape(raw, decoded) && decoded == name;
+    }
+
+    [[noreturn]] static void fail(const std::string& what, size_t at) {
+        throw new RuntimeError("Invalid JSON - " + what + " at byte " + std::to_string(at), 0);
+    }
+};
+
+namespace huff {
+    inline JsonDoc* toJson(const std::any& arg, std::string native) {
+        if (arg.type() != typeid(JsonDoc*)) {
+            throw new RuntimeError("Can't use " + native + "() on non-JSON document", 0);
+        }
+        return std::any_cast<JsonDoc*>(arg);
+    }
+}
+
+//jsonParse( text ) - a document to query with jsonGet & jsonCount
+class jsonParse : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        JsonDoc* doc = i->heap.make<JsonDoc>(huff::toHString(args[0], "jsonParse"));
+        RootScope scope(i->heap);
+        i->heap.pushRoot(doc);
+        doc->parse();
+        i->heap.charge(doc, doc->tape.capacity() * sizeof(huff::json::Node));
+        return doc;
+    }
+};
+
+//jsonGet( doc, path ) - the string, number, bool or nul at path ("" for the whole document)
+//nul when nothing is there
+class jsonGet : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter*, std::vector<std::any> args) {
+        JsonDoc* doc = huff::toJson(args[0], "jsonGet");
+        long at = doc->find(huff::toHString(args[1], "jsonGet").view());
+        return at < 0 ? std::any(NULL) : doc->value(at);
+    }
+};
+
+//jsonCount( doc, path ) - entries of the object or array at path, nul when nothing is there
+class jsonCount : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter*, std::vector<std::any> args) {
+        JsonDoc* doc = huff::toJson(args[0], "jsonCount");
+        long at = doc->find(huff::toHString(args[1], "jsonCount").view());
+        if (at < 0) return NULL;
+        const huff::json::Node& node = doc->tape[at];
+        if (node.type != huff::json::J_OBJECT && node.type != huff::json::J_ARRAY) {
+            throw new RuntimeError("Can't use jsonCount() on a JSON value that isn't an object or array", 0);
+        }
+        return (HInt)doc->count(at);
+    }
+};
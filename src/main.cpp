@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <limits>
+#include <cerrno>
+#include <cctype>
+#include "interpreter.hpp"
+#include "stats.hpp"
+
+//Reads the whole number after a flag's '=' into value - anything else (signs, junk, or too big for value) is a usage error
+template<typename T> bool flagValue(const char* arg, size_t prefix, T& value) {
+	const char* text = arg + prefix;
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long n = isdigit((unsigned char)*text) ? strtoull(text, &end, 10) : 0;
+	if (end == nullptr || *end != '\0' || errno == ERANGE || n > std::numeric_limits<T>::max()) {
+		std::cerr << "Huff Usage: " << std::string(arg, prefix - 1) << " expects a whole number, not '" << text << "'" << std::endl;
+		return false;
+	}
+	value = (T)n;
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	char* path = nullptr;
+	bool check = false;
+	unsigned jobs = std::thread::hardware_concurrency();
+	std::vector<std::string> checkList;
+	bool stats = false;
+	std::string statsPath;
+	std::string fromSnapshot;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--check") == 0) {
+			check = true;
+		} else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+			if (!flagValue(argv[i], 7, jobs)) return 1;
+		} else if (check) {
+			checkList.push_back(argv[i]);
+		} else if (strcmp(argv[i], "--gc-stress") == 0) {
+			gcStress = true;
+		} else if (strcmp(argv[i], "--dump-types") == 0) {
+			dumpTypes = true;
+		} else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			unsigned threads;
+			if (!flagValue(argv[i], 10, threads)) return 1;
+			setTaskThreads(threads);
+		} else if (strncmp(argv[i], "--gc-threshold=", 15) == 0) {
+			if (!flagValue(argv[i], 15, gcThreshold)) return 1;
+		} else if (strncmp(argv[i], "--max-steps=", 12) == 0) {
+			if (!flagValue(argv[i], 12, limits.maxSteps)) return 1;
+		} else if (strncmp(argv[i], "--timeout=", 10) == 0) {
+			if (!flagValue(argv[i], 10, limits.timeoutMs)) return 1;
+		} else if (strncmp(argv[i], "--max-depth=", 12) == 0) {
+			if (!flagValue(argv[i], 12, limits.maxDepth)) return 1;
+		} else if (strncmp(argv[i], "--max-heap=", 11) == 0) {
+			if (!flagValue(argv[i], 11, limits.maxHeap)) return 1;
+		} else if (strcmp(argv[i], "--stats") == 0) {
+			stats = true;
+		} else if (strncmp(argv[i], "--stats=", 8) == 0) {
+			statsPath = argv[i] + 8;
+		} else if (strncmp(argv[i], "--snapshot=", 11) == 0) {
+			snapshotPath = argv[i] + 11;
+		} else if (strncmp(argv[i], "--from-snapshot=", 16) == 0) {
+			fromSnapshot = argv[i] + 16;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	if ((stats || !statsPath.empty()) && !huff::stats::enabled) {
+		std::cerr << "huffle was built without HUFFLE_STATS - --stats isn't available" << std::endl;
+		return 1;
+	}
+	huff::stats::attach();
+
+	if (check) {
+		if (checkList.empty()) checkList.push_back(".");
+		return checkPaths(checkList, jobs);
+	}
+
+	if (path != nullptr || !fromSnapshot.empty()){
+		 if (fromSnapshot.empty()) {
+			runFile(path);
+		 } else {
+			runSnapshot(fromSnapshot);
+		 }
+		 //Printed to stderr, after (and apart from) the program's own output
+		 if (stats) {
+			huff::stats::write(huff::stats::total(), huff::stats::TEXT, std::cerr);
+		 }
+		 if (!statsPath.empty()) {
+			std::ofstream out(statsPath);
+			huff::stats::write(huff::stats::total(), huff::stats::formatFor(statsPath), out);
+		 }
+	} else {
+		std::cout << "Huff Usage: huffle [--gc-stress] [--gc-threshold=bytes] [--threads=N] [--dump-types] [filename].huff" << std::endl;
+		std::cout << "            limits: [--max-steps=N] [--timeout=ms] [--max-depth=N] [--max-heap=bytes]" << std::endl;
+		std::cout << "            stats:  [--stats] [--stats=file.json or file.prom]" << std::endl;
+		std::cout << "            images: [--snapshot=image] [filename].huff, then huffle --from-snapshot=image" << std::endl;
+		std::cout << "            huffle --check [--jobs=N] [files or directories...]" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <any>
+#include <set>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "utils.hpp"
+#include "hstring.hpp"
+#include "astwalk.hpp"
+#include "error.hpp"
+
+//Results of one @memo function, keyed on the values of its arguments
+//Only calls whose arguments are all nul, bools, numbers or strings are cached, and only results
+//of those kinds are kept - anything else runs as a normal call. An integer and a double are
+//different arguments, even when equal, as they can give different results.
+//A function passed to pfor is called from several threads at once, so the table is locked.
+class MemoCache {
+    struct Entry {
+        std::any result;
+        //Position in order (only with a limit)
+        std::list<const std::string*>::iterator used;
+    };
+
+    std::unordered_map<std::string, Entry> table;
+    //Keys from least to most recently used
+    std::list<const std::string*> order;
+    std::mutex lock;
+
+    template<typename T> static void append(std::string& key, char tag, const T& val) {
+        key += tag;
+        key.append((const char*)&val, sizeof(T));
+    }
+
+    public:
+    //Most entries kept, dropping the least recently used (0 for no limit)
+    size_t limit;
+
+    MemoCache(size_t limit) {
+        this->limit = limit;
+    }
+
+    //Builds the key for a call with args, false if one can't be part of a key
+    static bool key(const std::vector<std::any>& args, std::string& key) {
+        for (const std::any& arg : args) {
+            if (const HInt* i = std::any_cast<HInt>(&arg)) {
+                append(key, 'i', *i);
+            } else if (const double* d = std::any_cast<double>(&arg)) {
+                //-0 and 0 are the same argument
+                append(key, 'd', *d == 0 ? 0.0 : *d);
+            } else if (const HString* s = std::any_cast<HString>(&arg)) {
+                append(key, 's', s->size());
+                key.append(s->view());
+            } else if (const bool* b = std::any_cast<bool>(&arg)) {
+                key += *b ? 'T' : 'F';
+            } else if (arg.type() == typeid(long)) {
+                key += 'n';
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool cacheable(const std::any& result) {
+        const std::type_info& t = result.type();
+        return t == typeid(HInt) || t == typeid(double) || t == typeid(HString) || t == typeid(bool)
+            || t == typeid(long) || !result.has_value();
+    }
+
+    bool find(const std::string& key, std::any& result) {
+        std::lock_guard<std::mutex> hold(lock);
+        auto found = table.find(key);
+        if (found == table.end()) return false;
+        if (limit != 0) {
+            order.splice(order.end(), order, found->second.used);
+        }
+        result = found->second.result;
+        return true;
+    }
+
+    //Keeps result for key, returning the bytes the cache grew by (none once it's full)
+    size_t insert(const std::string& key, const std::any& result) {
+        if (const HString* s = std::any_cast<HString>(&result)) {
+            //Callers may be on other threads
+            s->freeze();
+        }
+
+        std::lock_guard<std::mutex> hold(lock);
+        auto [at, added] = table.try_emplace(key, Entry{result, {}});
+        if (!added || limit == 0) {
+            return added ? key.size() + sizeof(Entry) + sizeof(std::string) : 0;
+        }
+
+        at->second.used = order.insert(order.end(), &at->first);
+        if (table.size() <= limit) {
+            return key.size() + sizeof(Entry) + 2 * sizeof(std::string);
+        }
+        auto oldest = table.find(*order.front());
+        order.pop_front();
+        table.erase(oldest);
+        return 0;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> hold(lock);
+        return table.size();
+    }
+};
+
+//Finds what a @memo function does that a cached call would skip - output, input and assigning
+//variables it doesn't declare itself - in one walk, reported at the line of the first statement
+//doing each. Names are tracked for the whole function (not per block) as they're declared, which
+//is enough to tell its own variables from captured ones & globals. A @memo function nested in
+//another is checked on its own.
+class MemoCheck : public AstWalker {
+    Func* memo = nullptr;
+    std::set<std::string> locals;
+    std::set<std::string> reported;
+    std::vector<Warning>& warnings;
+
+    void declare(Func* s) {
+        locals.insert(s->name.lexeme);
+        for (const Token& param : s->params) locals.insert(param.lexeme);
+    }
+
+    void warn(const std::string& what, int line) {
+        std::string text = "@memo function " + memo->name.lexeme + " " + what + " - cached calls skip it";
+        if (reported.insert(text).second) {
+            warnings.push_back(Warning(text, line));
+        }
+    }
+
+    public:
+    using AstWalker::walk;
+
+    MemoCheck(std::vector<Warning>& warnings) : warnings(warnings) {}
+
+    std::any visitFunctionStmt(Func* s) {
+        if (!s->memo) {
+            //Part of the memo function being checked, or holding memo functions of its own
+            declare(s);
+            walk(s->body);
+            return NULL;
+        }
+        Func* outer = memo;
+        std::set<std::string> outerLocals;
+        outerLocals.swap(locals);
+        memo = s;
+        declare(s);
+        walk(s->body);
+        memo = outer;
+        locals.swap(outerLocals);
+        return NULL;
+    }
+
+    std::any visitVarStmt(Var* s) {
+        locals.insert(s->name.lexeme);
+        walk(s->initialiser);
+        return NULL;
+    }
+
+    std::any visitClassStmt(Class* s) {
+        locals.insert(s->name.lexeme);
+        locals.insert("this");
+        return AstWalker::visitClassStmt(s);
+    }
+
+    std::any visitImportStmt(Import* s) {
+        locals.insert(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitAssignmentExpr(Assignment* e) {
+        walk(e->expression);
+        if (memo != nullptr && locals.count(e->name.lexeme) == 0) {
+            warn("assigns " + e->name.lexeme + ", which it doesn't declare", e->name.line);
+        }
+        return NULL;
+    }
+
+    std::any visitPrintStmt(Print* s) {
+        walk(s->expression);
+        if (memo != nullptr) warn("calls out()", s->line);
+        return NULL;
+    }
+
+    std::any visitCallableExpr(Call* e) {
+        AstWalker::visitCallableExpr(e);
+        Variable* callee = dynamic_cast<Variable*>(e->callee);
+        if (memo != nullptr && callee != nullptr && callee->name.lexeme == "in" && locals.count("in") == 0) {
+            warn("calls in()", e->paren.line);
+        }
+        return NULL;
+    }
+};
+
+namespace huff {
+    //Warnings for every @memo function in stmts that isn't pure
+    inline std::vector<Warning> checkMemo(const std::vector<Stmt*>& stmts) {
+        std::vector<Warning> warnings;
+        MemoCheck(warnings).walk(stmts);
+        std::stable_sort(warnings.begin(), warnings.end(), [](const Warning& a, const Warning& b) { return a.line < b.line; });
+        return warnings;
+    }
+}
@@ -0,0 +1,168 @@
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include "modules.hpp"
+#include "visitor.hpp"
+#include "closures.hpp"
+#include "memo.hpp"
+#include "typeinfer.hpp"
+#include "interpreter.hpp"
+
+namespace huff {
+    //A module file - compiled & run at most once per process, whatever imports it
+    struct ModuleEntry {
+        std::string file;
+        //Held while compiling, so a prefetch & a load never both parse the file
+        std::mutex compileLock;
+        bool compiled = false;
+        std::atomic<bool> prefetched{false};
+        std::vector<Stmt*> stmts;
+        std::vector<std::string> imports;
+        //Runs the module's top level, then keeps its globals for as long as the process lives
+        std::unique_ptr<Interpreter> interp;
+        bool running = false;
+        //First compile or runtime error, reported to everything that uses the module
+        std::string error;
+        //Printed when the module is first run (compiles may happen on another thread)
+        std::vector<Warning> warnings;
+
+        void compile() {
+            std::lock_guard<std::mutex> hold(compileLock);
+            if (compiled) return;
+            compiled = true;
+
+            std::ifstream input(file);
+            if (!input) {
+                error = "no module file " + file;
+                return;
+            }
+            std::stringstream buffer;
+            buffer << input.rdbuf();
+
+            std::vector<Err*> errors;
+            stmts = parseSource(buffer.str(), errors);
+            if (!errors.empty()) {
+                error = errors.front()->text() + " on line " + std::to_string(errors.front()->line) + " of " + file;
+                for (Err* e : errors) {
+                    delete e;
+                }
+                freeAst(stmts);
+                stmts.clear();
+                return;
+            }
+
+            imports = resolveImports(stmts, std::filesystem::path(file).parent_path().string());
+            resolveClosures(stmts);
+            warnings = checkMemo(stmts);
+            inferTypes(stmts);
+        }
+    };
+
+    //Never freed - prefetches may still be finishing as the process exits
+    static std::map<std::string, std::shared_ptr<ModuleEntry>>& entries() {
+        static auto* entries = new std::map<std::string, std::shared_ptr<ModuleEntry>>();
+        return *entries;
+    }
+
+    static std::mutex entriesLock;
+    //Running a module's top level (and copying globals out of any module) happens one at a time,
+    //so a top level can use other modules - re-entered by the same thread, never by two at once
+    static std::recursive_mutex runLock;
+    //Bumped by cancelPrefetch - queued prefetches from before it are skipped
+    static std::atomic<long> generation{0};
+
+    static std::shared_ptr<ModuleEntry> entry(const std::string& file) {
+        std::lock_guard<std::mutex> hold(entriesLock);
+        std::shared_ptr<ModuleEntry>& found = entries()[file];
+        if (found == nullptr) {
+            found = std::make_shared<ModuleEntry>();
+            found->file = file;
+        }
+        return found;
+    }
+
+    void prefetchModule(const std::string& file) {
+        std::shared_ptr<ModuleEntry> module = entry(file);
+        if (module->prefetched.exchange(true)) return;
+
+        long started = generation.load();
+        pool().submit([module, started] {
+            if (generation.load() != started) return;
+            module->compile();
+            for (const std::string& next : module->imports) {
+                prefetchModule(next);
+            }
+        });
+    }
+
+    void cancelPrefetch() {
+        generation++;
+    }
+
+    //Runs the module's top level in an interpreter of its own, with the importer's settings
+    static void run(ModuleEntry& module, Interpreter* importer) {
+        for (Warning& warning : module.warnings) {
+            warning.msg();
+        }
+        module.running = true;
+        module.interp = std::make_unique<Interpreter>();
+        Interpreter* interp = module.interp.get();
+        interp->heap.setThreshold(importer->heap.threshold);
+        interp->heap.stress = importer->heap.stress;
+        interp->budget.limits = importer->budget.limits;
+
+        try {
+            interp->startBudget();
+            for (Stmt* stmt : module.stmts) {
+                interp->step();
+                stmt->accept(interp);
+            }
+        } catch (Err* e) {
+            module.error = e->text() + " on line " + std::to_string(e->line) + " of " + module.file;
+            delete e;
+        }
+        module.running = false;
+    }
+
+    static void load(Interpreter* i, Module* m, int line) {
+        std::shared_ptr<ModuleEntry> module = entry(m->file);
+        module->compile();
+
+        std::lock_guard<std::recursive_mutex> hold(runLock);
+        if (module->running) {
+            throw new RuntimeError("Module " + m->name + " is used by its own top level (circular import)", line);
+        }
+        if (module->error.empty() && module->interp == nullptr) {
+            run(*module, i);
+        }
+        if (!module->error.empty()) {
+            throw new RuntimeError("Module " + m->name + " failed - " + module->error, line);
+        }
+
+        RootScope scope(i->heap);
+        i->heap.pushRoot(m);
+        Enviroment* exports = i->heap.make<Enviroment>(false);
+        i->heap.pushRoot(exports);
+        //Module functions change this interpreter's copy of the module's dictionaries & instances
+        Transplant copy(module->interp.get(), i, exports);
+        copy.mutables = true;
+        copy.env(module->interp->global);
+        m->exports = exports;
+    }
+
+    std::any moduleGet(Interpreter* i, Module* m, const Token& name) {
+        if (m->exports == nullptr) {
+            load(i, m, name.line);
+        }
+        std::any* found = m->exports->find(name.lexeme);
+        GcObject* object = found == nullptr ? nullptr : Heap::objectOf(*found);
+        if (found == nullptr || dynamic_cast<Dict*>(object) != nullptr || dynamic_cast<Instance*>(object) != nullptr
+                || dynamic_cast<BoundMethod*>(object) != nullptr) {
+            throw new RuntimeError("Module " + m->name + " has no " + name.lexeme + " (only functions, classes & immutable globals are shared)", name.line);
+        }
+        return *found;
+    }
+}
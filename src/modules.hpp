@@ -0,0 +1,72 @@
+#pragma once
+
+#include <any>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "hcall.hpp"
+#include "astwalk.hpp"
+
+//A module as one interpreter sees it - bound by an import statement, and loaded the first time
+//one of its names is used
+class Module : public GcObject {
+    public:
+    std::string file;
+    std::string name;
+    //This interpreter's copy of the module's globals, once loaded
+    Enviroment* exports = nullptr;
+
+    Module(std::string file, std::string name) {
+        this->file = file;
+        this->name = name;
+    }
+
+    void trace(Heap& heap) {
+        heap.mark(exports);
+    }
+};
+
+//Points every import in a program at its module file - import a.b; is a/b.huff next to the program
+class ImportResolver : public AstWalker {
+    std::filesystem::path dir;
+
+    public:
+    using AstWalker::walk;
+    std::vector<std::string> files;
+
+    ImportResolver(const std::vector<Stmt*>& stmts, const std::string& dir) {
+        this->dir = std::filesystem::absolute(dir.empty() ? "." : dir);
+        walk(stmts);
+    }
+
+    std::any visitImportStmt(Import* s) {
+        std::filesystem::path file = dir;
+        for (const Token& part : s->path) {
+            file /= part.lexeme;
+        }
+        file += ".huff";
+        s->file = file.lexically_normal().string();
+        files.push_back(s->file);
+        return NULL;
+    }
+};
+
+//Modules are cached per process - each file is scanned, parsed & run at most once, then every
+//interpreter that uses it gets a copy of its globals (like a spawned task does, but with copies of
+//its dictionaries & instances too, for its functions to use - only immutable ones can be read by name)
+namespace huff {
+    //Sets the file of every import in stmts, returning them in program order
+    inline std::vector<std::string> resolveImports(const std::vector<Stmt*>& stmts, const std::string& dir) {
+        return ImportResolver(stmts, dir).files;
+    }
+
+    //Starts compiling a module on the task pool, ahead of its first use - modules it imports
+    //are prefetched in turn as it finishes, so an import graph compiles in parallel
+    void prefetchModule(const std::string& file);
+
+    //Drops prefetches that haven't started (when the program finishes first)
+    void cancelPrefetch();
+
+    //Value of name in module m, loading m into i first if this is its first use
+    std::any moduleGet(Interpreter* i, Module* m, const Token& name);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <any>
+#include <cmath>
+#include "types.hpp"
+#include "utils.hpp"
+#include "error.hpp"
+#include "gc.hpp"
+
+//Arithmetic over the two number kinds
+//Integers stay integers through + - * (overflowing int64 is an error, never a silent wrap or
+//loss of precision), / always gives a double, and an operation mixing the kinds promotes
+//the integer to a double first
+namespace huff {
+    inline bool isNumber(const std::any& val) {
+        return val.type() == typeid(HInt) || val.type() == typeid(double);
+    }
+
+    //Number of either kind as a double - the caller has checked val is a number
+    inline double promote(const std::any& val) {
+        const HInt* i = std::any_cast<HInt>(&val);
+        return i != nullptr ? (double)*i : toDouble(val);
+    }
+
+    inline HInt overflow(int line) {
+        throw new RuntimeError("Integer overflow", line);
+    }
+
+    inline std::any intArithmetic(TokenType op, HInt a, HInt b, int line) {
+        HInt r;
+        switch (op) {
+            case PLUS:
+                return __builtin_add_overflow(a, b, &r) ? overflow(line) : r;
+            case MINUS:
+                return __builtin_sub_overflow(a, b, &r) ? overflow(line) : r;
+            case STAR:
+                return __builtin_mul_overflow(a, b, &r) ? overflow(line) : r;
+            case SLASH:
+                return (double)a / (double)b;
+            case LESS:
+                return a < b;
+            case GREATER:
+                return a > b;
+            case GR_EQUAL:
+                return a >= b;
+            case LE_EQUAL:
+                return a <= b;
+            case IS_EQUAL:
+                return a == b;
+            case ISN_EQUAL:
+                return a != b;
+            default:
+                throw new RuntimeError("Unsupported numeric operator " + convert[op], line);
+        }
+    }
+
+    inline std::any doubleArithmetic(TokenType op, double a, double b, int line) {
+        switch (op) {
+            case PLUS:
+                return a + b;
+            case MINUS:
+                return a - b;
+            case STAR:
+                return a * b;
+            case SLASH:
+                return a / b;
+            case LESS:
+                return a < b;
+            case GREATER:
+                return a > b;
+            case GR_EQUAL:
+                return a >= b;
+            case LE_EQUAL:
+                return a <= b;
+            case IS_EQUAL:
+                return a == b;
+            case ISN_EQUAL:
+                return a != b;
+            default:
+                throw new RuntimeError("Unsupported numeric operator " + convert[op], line);
+        }
+    }
+
+    //Both values must be numbers
+    inline std::any arithmetic(TokenType op, const std::any& left, const std::any& right, int line) {
+        const HInt* a = std::any_cast<HInt>(&left);
+        const HInt* b = std::any_cast<HInt>(&right);
+        if (a != nullptr && b != nullptr) {
+            return intArithmetic(op, *a, *b, line);
+        }
+        return doubleArithmetic(op, promote(left), promote(right), line);
+    }
+
+    inline HInt negate(HInt a, int line) {
+        HInt r;
+        return __builtin_sub_overflow((HInt)0, a, &r) ? overflow(line) : r;
+    }
+
+    //Numbers compare by value whatever their kind, strings by their bytes, and objects (functions,
+    //classes, instances, dictionaries...) by identity - values of different types are never equal
+    inline bool equal(const std::any& left, const std::any& right) {
+        const HString* leftStr = std::any_cast<HString>(&left);
+        const HString* rightStr = std::any_cast<HString>(&right);
+        if (leftStr != nullptr && rightStr != nullptr) {
+            return *leftStr == *rightStr;
+        }
+        bool leftNum = isNumber(left);
+        bool rightNum = isNumber(right);
+        if (leftNum && rightNum) {
+            return std::any_cast<bool>(arithmetic(IS_EQUAL, left, right, 0));
+        }
+        if (leftNum || rightNum || left.type() != right.type()) {
+            return false;
+        }
+        if (const bool* b = std::any_cast<bool>(&left)) {
+            return *b == std::any_cast<bool>(right);
+        }
+        GcObject* object = Heap::objectOf(left);
+        if (object != nullptr) {
+            return object == Heap::objectOf(right);
+        }
+        //nul
+        return anyToString(left) == anyToString(right);
+    }
+}
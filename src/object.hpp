@@ -0,0 +1,169 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "gc.hpp"
+#include "hcall.hpp"
+
+//Hidden class describing the field layout of an instance
+//Instances that add the same fields in the same order share one shape, so a field
+//name resolves to the same slot index for all of them
+//Parallel workers can share a class, so new transitions are made under a lock, and a
+//shape's fields never change once it has been published
+class Shape {
+    public:
+    //Unique for the life of the process, so inline caches never match a recycled address
+    uint64_t id;
+    Shape* parent;
+    std::vector<std::string> fields;
+    std::map<std::string, Shape*> transitions;
+    //Last transition taken - instances usually add their fields in the same order
+    std::atomic<Shape*> lastWith{nullptr};
+
+    static std::mutex& transitionLock() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    Shape(Shape* parent) {
+        static std::atomic<uint64_t> nextId{1};
+        this->id = nextId++;
+        this->parent = parent;
+        if (parent != nullptr) {
+            this->fields = parent->fields;
+        }
+    }
+
+    ~Shape() {
+        for (auto& t : transitions) {
+            delete t.second;
+        }
+    }
+
+    int slotOf(const std::string& name) {
+        for (int x = 0; x < fields.size(); x++) {
+            if (fields[x] == name) return x;
+        }
+        return -1;
+    }
+
+    //Shape reached by adding a field - created once, then shared
+    Shape* with(const std::string& name) {
+        Shape* last = lastWith.load(std::memory_order_acquire);
+        if (last != nullptr && last->fields.back() == name) {
+            return last;
+        }
+
+        std::lock_guard<std::mutex> guard(transitionLock());
+        auto found = transitions.find(name);
+        if (found != transitions.end()) {
+            lastWith.store(found->second, std::memory_order_release);
+            return found->second;
+        }
+
+        Shape* next = new Shape(this);
+        next->fields.push_back(name);
+        transitions[name] = next;
+        lastWith.store(next, std::memory_order_release);
+        return next;
+    }
+};
+
+class HClass;
+
+class Instance : public GcObject {
+    public:
+    HClass* klass;
+    Shape* shape;
+    std::vector<std::any> slots;
+
+    Instance(HClass* klass, Shape* shape, int expectedSlots) {
+        this->klass = klass;
+        this->shape = shape;
+        this->slots.reserve(expectedSlots);
+    }
+
+    void trace(Heap& heap);
+};
+
+class HClass : public HCallable {
+    public:
+    Class* declaration;
+    std::map<std::string, UDCallable*> methods;
+    Shape* root;
+    //Largest field count seen - new instances reserve this many slots up front
+    std::atomic<int> expectedSlots{0};
+
+    HClass(Class* declaration) {
+        this->declaration = declaration;
+        this->root = new Shape(nullptr);
+        this->native = false;
+    }
+
+    ~HClass() {
+        delete root;
+    }
+
+    void trace(Heap& heap) {
+        for (auto& m : methods) {
+            heap.mark(m.second);
+        }
+    }
+
+    UDCallable* findMethod(const std::string& name) {
+        auto found = methods.find(name);
+        if (found == methods.end()) {
+            return nullptr;
+        }
+        return found->second;
+    }
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        Instance* instance = i->heap.make<Instance>(this, root, expectedSlots);
+        std::any self = instance;
+        RootScope scope(i->heap);
+        i->heap.pushRoot(&self);
+
+        UDCallable* init = findMethod("init");
+        if (init != nullptr) {
+            init->invoke(i, args, self);
+        } else if (args.size() != 0) {
+            throw new RuntimeError("Invalid argument count for class: " + declaration->name.lexeme, 0);
+        }
+
+        return instance;
+    }
+};
+
+//Method value produced by reading a method off an instance, ie: p.move
+class BoundMethod : public HCallable {
+    public:
+    UDCallable* method;
+    Instance* self;
+
+    BoundMethod(UDCallable* method, Instance* self) {
+        this->method = method;
+        this->self = self;
+        this->native = false;
+    }
+
+    void trace(Heap& heap) {
+        heap.mark(method);
+        heap.mark(self);
+    }
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        return method->invoke(i, args, self);
+    }
+};
+
+inline void Instance::trace(Heap& heap) {
+    heap.mark(klass);
+    for (auto& v : slots) {
+        heap.markValue(v);
+    }
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <set>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cmath>
+#include "hcall.hpp"
+#include "astwalk.hpp"
+#include "dict.hpp"
+#include "tasks.hpp"
+
+//Finds variables a function assigns without declaring them itself (parameters & udv)
+//Parallel workers share the function's closure, so assigning a captured variable would race
+//This only sees the function's own body - writes made through the functions it calls (or to
+//shared dictionaries, instances & files) are stopped as they happen, see Interpreter::mutating
+class CaptureCheck : public AstWalker {
+    std::set<std::string> declared;
+
+    public:
+    using AstWalker::walk;
+    std::string captured;
+
+    CaptureCheck(Func* func) {
+        for (const Token& param : func->params) {
+            declared.insert(param.lexeme);
+        }
+        walk(func->body);
+    }
+
+    std::any visitVarStmt(Var* s) {
+        declared.insert(s->name.lexeme);
+        walk(s->initialiser);
+        return NULL;
+    }
+
+    std::any visitAssignmentExpr(Assignment* e) {
+        if (captured.empty() && declared.count(e->name.lexeme) == 0) {
+            captured = e->name.lexeme;
+        }
+        walk(e->expression);
+        return NULL;
+    }
+
+    //Nested declarations have scopes of their own and only run if called
+    std::any visitFunctionStmt(Func* s) {
+        declared.insert(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitClassStmt(Class* s) {
+        declared.insert(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitImportStmt(Import* s) {
+        declared.insert(s->name.lexeme);
+        return NULL;
+    }
+};
+
+//Part of a range, run on one worker
+struct RangeChunk {
+    long from;
+    long to;
+    std::vector<std::any> results;
+    std::any folded;
+    Err* error = nullptr;
+
+    RangeChunk(long from, long to) : from(from), to(to) {}
+};
+
+namespace huff {
+    //Fixed chunk count, so how a range is split (and so the order values are combined in)
+    //never depends on the number of threads
+    static const long RANGE_CHUNKS = 256;
+
+    //Checks fn can be called from several workers at once
+    inline HCallable* toParallel(const std::any& arg, std::string native) {
+        if (arg.type() != typeid(HCallable*)) {
+            throw new RuntimeError(native + "() expects a function", 0);
+        }
+        HCallable* fn = std::any_cast<HCallable*>(arg);
+        if (dynamic_cast<BoundMethod*>(fn) != nullptr) {
+            throw new RuntimeError(native + "() can't run a bound method (its instance is mutable)", 0);
+        }
+        if (UDCallable* f = dynamic_cast<UDCallable*>(fn)) {
+            CaptureCheck check(f->declaration);
+            if (!check.captured.empty()) {
+                throw new RuntimeError(native + "() function " + f->declaration->name.lexeme + " assigns captured variable " + check.captured, 0);
+            }
+        }
+        return fn;
+    }
+
+    inline long toBound(const std::any& arg, std::string native) {
+        if (arg.type() == typeid(HInt)) {
+            return std::any_cast<HInt>(arg);
+        }
+        //NaN fails both comparisons, so is rejected with infinities & values past long's range
+        double bound = arg.type() == typeid(double) ? std::floor(std::any_cast<double>(arg)) : NAN;
+        if (!(bound >= -9223372036854775808.0 && bound < 9223372036854775808.0)) {
+            throw new RuntimeError(native + "() expects numeric range bounds", 0);
+        }
+        return (long)bound;
+    }
+
+    inline std::any callParallel(HCallable* fn, Interpreter* worker, std::vector<std::any> args) {
+        std::any val = fn->call(worker, std::move(args));
+        if (!Task::share(val)) {
+            throw new RuntimeError("Parallel function returned a mutable value (only numbers, strings, bools & nul can be returned)", 0);
+        }
+        return val;
+    }
+
+    //Splits [start, end) into chunks and runs body(worker, chunk) for each across the task pool
+    //Every chunk gets an interpreter (so a frame stack & heap) of its own, while the caller's
+    //interpreter waits - its scopes are only read until all chunks finish. The first error
+    //(in range order) is rethrown.
+    template<typename F> std::vector<RangeChunk> forRange(Interpreter* i, long start, long end, F body) {
+        std::vector<RangeChunk> chunks;
+        long n = end - start;
+        if (n <= 0) return chunks;
+
+        long count = std::min(n, RANGE_CHUNKS);
+        long grain = (n + count - 1) / count;
+        for (long from = start; from < end; from += grain) {
+            chunks.emplace_back(from, std::min(from + grain, end));
+        }
+
+        std::atomic<size_t> finished{0};
+        size_t threshold = i->heap.threshold;
+        bool stress = i->heap.stress;
+        const Budget& budget = i->budget;
+        StrBuf::sharing++;
+
+        TaskPool& pool = huff::pool();
+        for (RangeChunk& chunk : chunks) {
+            RangeChunk* c = &chunk;
+            pool.submit([c, &finished, &body, &budget, threshold, stress] {
+                try {
+                    Interpreter worker;
+                    worker.worker = true;
+                    worker.heap.setThreshold(threshold);
+                    worker.heap.stress = stress;
+                    worker.heap.setLimit(budget.limits.maxHeap);
+                    worker.budget.inherit(budget);
+                    body(&worker, *c);
+                } catch (Err* e) {
+                    c->error = e;
+                } catch (...) {
+                    c->error = new RuntimeError("Parallel worker failed", 0);
+                }
+                finished++;
+            });
+        }
+        pool.helpUntil([&] { return finished.load() == chunks.size(); });
+        StrBuf::sharing--;
+
+        Err* error = nullptr;
+        for (RangeChunk& chunk : chunks) {
+            if (error == nullptr) {
+                error = chunk.error;
+            } else {
+                delete chunk.error;
+            }
+        }
+        if (error != nullptr) throw error;
+        return chunks;
+    }
+}
+
+//pfor( fn, start, end ) - calls fn(i) for every i from start up to (not including) end in
+//parallel, returns a dictionary of i -> fn(i)
+class pfor : public HCallable {
+    public:
+    int numArgs=3;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        if (args.size() != 3) {
+            throw new RuntimeError("pfor() expects a function, a start and an end", 0);
+        }
+        HCallable* fn = huff::toParallel(args[0], "pfor");
+        long start = huff::toBound(args[1], "pfor");
+        long end = huff::toBound(args[2], "pfor");
+
+        std::vector<RangeChunk> chunks = huff::forRange(i, start, end, [fn](Interpreter* worker, RangeChunk& chunk) {
+            chunk.results.reserve(chunk.to - chunk.from);
+            for (long k = chunk.from; k < chunk.to; k++) {
+                chunk.results.push_back(huff::callParallel(fn, worker, {(HInt)k}));
+            }
+        });
+
+        Dict* dict = i->heap.make<Dict>();
+        for (RangeChunk& chunk : chunks) {
+            for (long k = chunk.from; k < chunk.to; k++) {
+                dict->set(DictKey((HInt)k), chunk.results[k - chunk.from]);
+            }
+        }
+        dict->version++;
+        return dict;
+    }
+};
+
+//preduce( fn, start, end, init, combine ) - combine(...combine(combine(init, fn(start)), fn(start + 1))..., fn(end - 1))
+//Chunks are folded in parallel then combined in range order, so combine must be associative;
+//the result is the same for any number of threads
+class preduce : public HCallable {
+    public:
+    int numArgs=5;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        if (args.size() != 5) {
+            throw new RuntimeError("preduce() expects a function, a start, an end, an initial value and a combine function", 0);
+        }
+        HCallable* fn = huff::toParallel(args[0], "preduce");
+        long start = huff::toBound(args[1], "preduce");
+        long end = huff::toBound(args[2], "preduce");
+        HCallable* combine = huff::toParallel(args[4], "preduce");
+
+        std::vector<RangeChunk> chunks = huff::forRange(i, start, end, [fn, combine](Interpreter* worker, RangeChunk& chunk) {
+            RootScope scope(worker->heap);
+            std::any acc = huff::callParallel(fn, worker, {(HInt)chunk.from});
+            worker->heap.pushRoot(&acc);
+            for (long k = chunk.from + 1; k < chunk.to; k++) {
+                std::any next = huff::callParallel(fn, worker, {(HInt)k});
+                acc = huff::callParallel(combine, worker, {acc, next});
+            }
+            chunk.folded = acc;
+        });
+
+        RootScope scope(i->heap);
+        std::any acc = args[3];
+        i->heap.pushRoot(&acc);
+        for (RangeChunk& chunk : chunks) {
+            acc = combine->call(i, {acc, chunk.folded});
+        }
+        return acc;
+    }
+};
@@ -1,6 +1,5 @@
 #pragma once
 #include <vector>
-#include <cstdarg>
 #include "token.hpp"
 #include "types.hpp"
 #include "expr.hpp"
@@ -10,30 +9,52 @@
 
 
 
+//Binding power of each infix operator, lowest first
+enum Precedence {
+    PREC_NONE,
+    PREC_ASSIGNMENT,  // =
+    PREC_OR,          // or
+    PREC_AND,         // and
+    PREC_EQUALITY,    // == !=
+    PREC_COMPARISON,  // < > <= >=
+    PREC_TERM,        // + -
+    PREC_FACTOR,      // * /
+    PREC_UNARY,       // - !
+    PREC_CALL,        // () .
+    PREC_PRIMARY
+};
+
+class Parser;
+
+//Row of the Pratt table - how a token parses at the start of an expression (prefix),
+//how it continues one (infix), and how tightly that infix binds
+struct ParseRule {
+    Expr* (Parser::*prefix)();
+    Expr* (Parser::*infix)(Expr*);
+    Precedence precedence;
+};
+
 class Parser {
     std::vector<Token> tokens;
     int current = 0;
 
-    bool isAtEnd() {
-        return peek().type == EF;
-    }
+    //Every error found - declaration() records each one then resynchronises
+    std::vector<ParseError*> errors;
 
-    Token peek() {
-        return tokens.at(current);
+    bool isAtEnd() const {
+        return tokens[current].type == EF;
     }
 
-    Token previous() {
-        return tokens.at(current-1);
+    const Token& peek() const {
+        return tokens[current];
     }
 
-    bool check(TokenType t) {
-        if (isAtEnd()){
-            return false;
-        } else if (tokens.at(current).type == t){
-            return true;
-        }
+    const Token& previous() const {
+        return tokens[current-1];
+    }
 
-        return false;
+    bool check(TokenType t) const {
+        return !isAtEnd() && tokens[current].type == t;
     }
 
     void synchronise() {
@@ -46,6 +67,8 @@ class Parser {
 
             switch (peek().type) {
                 case CLASS:
+                case IMPORT:
+                case AT:
                 case FUNC:
                 case UDV:
                 case FOR:
@@ -61,77 +84,111 @@ class Parser {
         }
     }
 
-    Token advance() {
+    const Token& advance() {
         if (!isAtEnd()) current++;
         return previous();
     }
 
-    bool match(int count, ...) {
-        va_list v;
-        va_start(v,count);
-
-        for (int i=0; i<count; i++) {
-            TokenType e = (TokenType)va_arg(v, int);
-            if (check(e)){
-                advance();
-                return true;
-            }
+    bool match(TokenType t) {
+        if (check(t)) {
+            advance();
+            return true;
         }
-
         return false;
     }
 
-    Token consume(TokenType t, std::string msg) {
+    const Token& consume(TokenType t, std::string msg) {
         if (check(t)){
             return advance();
         } else {
-            throw(new ParseError(msg, tokens.at(current-1).line));
+            throw(new ParseError(msg, tokens[current-1].line));
         }
     }
 
     public:
-    Parser(std::vector<Token>  tokens) {
-        this->tokens = tokens;
+    Parser(std::vector<Token> tokens) {
+        this->tokens = std::move(tokens);
     }
 
+    //Parses the whole program, recovering from errors - check errs() before running the result
     std::vector<Stmt*> parse() {
         std::vector<Stmt*> stmts;
-
-        try {
-            while (!isAtEnd()){
-                stmts.push_back(declaration());
+        while (!isAtEnd()){
+            if (Stmt* stmt = declaration()) {
+                stmts.push_back(stmt);
             }
-            return stmts;
-
-        } catch (Err* e) {
-            e->msg();
         }
+        return stmts;
+    }
 
-        return std::vector<Stmt*>(0);
+    //Errors found by parse(), owned by the caller
+    std::vector<ParseError*>& errs() {
+        return errors;
     }
 
     Stmt* declaration() {
         try {
-            if (match(1,UDV)) {
+            if (match(UDV)) {
                 return varDeclaration();
-            } else if (match(1, FUNC)) {
+            } else if (match(FUNC)) {
                 return funcDeclaration("function");
-            } else if (match(1, CLASS)) {
+            } else if (match(CLASS)) {
                 return classDeclaration();
+            } else if (match(IMPORT)) {
+                return importDeclaration();
+            } else if (match(AT)) {
+                return annotatedDeclaration();
             }
 
             return statement();
-        } catch (ParseError error) {
-                synchronise();
-                return NULL;
+        } catch (ParseError* error) {
+            errors.push_back(error);
+            synchronise();
+            return nullptr;
         }
     }
 
+    Stmt* importDeclaration() {
+        const Token& keyword = previous();
+        std::vector<Token> path;
+        path.push_back(consume(IDENTIFIER, "expected a module name after import"));
+        while (match(DOT)) {
+            path.push_back(consume(IDENTIFIER, "expected a module name after '.'"));
+        }
+        consume(SEMI_COL, "Expected semi-colon after import");
+        return new Import(keyword, path);
+    }
+
+    //@memo func f(...) {...} - or @memo(n) to keep only the n most recently used results
+    Stmt* annotatedDeclaration() {
+        const Token& name = consume(IDENTIFIER, "expected an annotation name after '@'");
+        if (name.lexeme != "memo") {
+            throw(new ParseError("Unknown annotation @" + name.lexeme, name.line));
+        }
+
+        size_t limit = 0;
+        if (match(LEFT_BR)) {
+            const Token& size = consume(INTEGER, "expected a cache size after '@memo('");
+            const HInt* n = std::any_cast<HInt>(&size.literal);
+            if (n == nullptr || *n <= 0) {
+                throw(new ParseError("@memo cache size must be a positive whole number", size.line));
+            }
+            limit = *n;
+            consume(RIGHT_BR, "Expected a ')' after @memo cache size");
+        }
+
+        consume(FUNC, "@memo can only be used on a function declaration");
+        Func* func = funcDeclaration("function");
+        func->memo = true;
+        func->memoLimit = limit;
+        return func;
+    }
+
     Stmt* varDeclaration() {
-        Token name = consume(IDENTIFIER, "expected indentifier after UDV statement");
-        if (match(1,SEMI_COL)){
-            //Create new variable
-            return new Var(name,new Literal(std::any(double(0))));
+        const Token& name = consume(IDENTIFIER, "expected indentifier after UDV statement");
+        if (match(SEMI_COL)){
+            //Create new variable - an integer 0, so it counts like one written out
+            return new Var(name,new Literal(std::any((HInt)0)));
         }
 
         consume(EQUAL, "invalid variable declaration (expected ';' or '='");
@@ -141,16 +198,16 @@ class Parser {
     }
 
     Func* funcDeclaration(std::string type) {
-        Token name = consume(IDENTIFIER, "expected identifier after" + type + "statement");
-        Token bracket = consume(LEFT_BR, "Expected a '(' before" + type +  "parameter list");
+        const Token& name = consume(IDENTIFIER, "expected identifier after" + type + "statement");
+        const Token& bracket = consume(LEFT_BR, "Expected a '(' before" + type +  "parameter list");
         std::vector<Token> args;
         if (!check(RIGHT_BR)) {
             args.push_back(consume(IDENTIFIER, "Function parameters must only consist of identifiers"));
-            while (match(1,COMMA)){
+            while (match(COMMA)){
                 args.push_back(consume(IDENTIFIER, "Function parameters must only consist of identifiers"));
 
                 if (args.size() >= 255) {
-                    throw ParseError("Function declaration has too many parameters", bracket.line);
+                    throw(new ParseError("Function declaration has too many parameters", bracket.line));
                 }
             }
         }
@@ -161,8 +218,8 @@ class Parser {
     }
 
     Stmt* classDeclaration() {
-        Token name = consume(IDENTIFIER, "expected identifier after class statement");
-        if (match(1,SEMI_COL)) {
+        const Token& name = consume(IDENTIFIER, "expected identifier after class statement");
+        if (match(SEMI_COL)) {
             return new Class(name, std::vector<Func*>());
         }
 
@@ -178,19 +235,19 @@ class Parser {
     };
 
     Stmt* statement() {
-        if (match(1,PRINT)) {
+        if (match(PRINT)) {
             consume(LEFT_BR,"expected a '(' before print statement");
             Stmt* exp = printStatement();
             return exp;
-        } else if (match(1,LEFT_CURL)){
+        } else if (match(LEFT_CURL)){
             return new Block(block());
-        } else if (match(1, IF)) {
+        } else if (match(IF)) {
             return conditional();
-        } else if (match(1, WHILE)){
+        } else if (match(WHILE)){
             return whileLoop();
-        } else if (match(1,FOR)){
+        } else if (match(FOR)){
             return forLoop();
-        } else if (match(1, RETURN)){
+        } else if (match(RETURN)){
             Expr* exp = expression();
             consume(SEMI_COL, "Expected semi-colon after return statement");
             return new Return(exp);
@@ -211,12 +268,12 @@ class Parser {
         consume(RIGHT_BR, "Expected ')' after conditional expression");
         Stmt* thenBranch = statement();
 
-        if (match(1,ELSE)) {
+        if (match(ELSE)) {
             Stmt* elseBranch = statement();
             return new Conditional(condition,thenBranch,elseBranch);
         } else {
             std::vector<Conditional*> elfs;
-            while (match(1,ELF) && !isAtEnd()) {
+            while (match(ELF) && !isAtEnd()) {
                 elfs.push_back(elfConditional());
             }
 
@@ -225,22 +282,24 @@ class Parser {
     }
 
     Stmt* whileLoop() {
+        Token keyword = previous();
         consume(LEFT_BR, "Expected '(' before loop expression");
         Expr* condition = expression();
         consume(RIGHT_BR, "Expected ')' after loop expression");
         Stmt* body = statement();
 
-        return new CWhile(condition, body);
+        return new CWhile(condition, body, keyword);
     }
 
     Stmt* forLoop() {
+        Token keyword = previous();
         consume(LEFT_BR, "Expected '(' after for keyword");
 
         Stmt* init;
-        if (match(1,SEMI_COL)) {
+        if (match(SEMI_COL)) {
             //no initialiser
             init = nullptr;
-        } else if (match(1,UDV)) {
+        } else if (match(UDV)) {
             init = varDeclaration();
         } else {
             init = expressionStatement();
@@ -269,7 +328,7 @@ class Parser {
         if (condition == nullptr) {
             condition=new Literal(true);
         }
-        body = new CWhile(condition, body);
+        body = new CWhile(condition, body, keyword);
 
         if (init != nullptr) {
             body = new Block(std::vector<Stmt*>{init,body});
@@ -294,7 +353,7 @@ class Parser {
         consume(RIGHT_BR, "Expected ')' after conditional expression");
         Stmt* thenBranch = statement();
 
-        if (match(1,ELSE)) {
+        if (match(ELSE)) {
             return new Conditional(condition, thenBranch, statement());
         } else {
             return new Conditional(condition,thenBranch);
@@ -304,7 +363,9 @@ class Parser {
     std::vector<Stmt*> block() {
         std::vector<Stmt*> stmts;
         while (!isAtEnd() && !check(RIGHT_CURL)){
-            stmts.push_back(declaration());
+            if (Stmt* stmt = declaration()) {
+                stmts.push_back(stmt);
+            }
         }
 
         consume(RIGHT_CURL, "Expected a '}' after scope");
@@ -312,163 +373,157 @@ class Parser {
     }
 
     Stmt* printStatement() {
+        int line = previous().line;
         Expr* val = expression();
         consume(RIGHT_BR,"expected a ') after print statement");
         consume(SEMI_COL, "Exprected semi-colon after statement");
-        return new Print(val);
+        return new Print(val, line);
     }
 
 
     Expr* expression() {
-        return assignment();
-    }
-
-    Expr* assignment() {
-        Expr* val = logicalOr();
-
-        if (match(1,EQUAL))  {
-            try {
-                Variable* lval = dynamic_cast<Variable*>(val);
-
-                //Not 'equality' since x=y=10 is allowed (recursive assignment)
-                Expr* right = assignment();
-                return new Assignment(dynamic_cast<Variable*>(lval)->name, right);
-            } catch (std::bad_cast err) {
-                throw ParseError("Invalid assignment of non-udv", tokens.at(current-2).line);
-            }
+        return parsePrecedence(PREC_ASSIGNMENT);
+    }
+
+    static const ParseRule& rule(TokenType t) {
+        static const std::vector<ParseRule> rules = [] {
+            std::vector<ParseRule> r(EF + 1, ParseRule{nullptr, nullptr, PREC_NONE});
+            r[LEFT_BR]    = {&Parser::grouping,    &Parser::finishCall, PREC_CALL};
+            r[DOT]        = {nullptr,              &Parser::dot,        PREC_CALL};
+            r[LEFT_CURL]  = {&Parser::dictLiteral, nullptr,             PREC_NONE};
+            r[MINUS]      = {&Parser::unary,       &Parser::binary,     PREC_TERM};
+            r[PLUS]       = {nullptr,              &Parser::binary,     PREC_TERM};
+            r[STAR]       = {nullptr,              &Parser::binary,     PREC_FACTOR};
+            r[SLASH]      = {nullptr,              &Parser::binary,     PREC_FACTOR};
+            r[EXL]        = {&Parser::unary,       nullptr,             PREC_NONE};
+            r[IS_EQUAL]   = {nullptr,              &Parser::binary,     PREC_EQUALITY};
+            r[ISN_EQUAL]  = {nullptr,              &Parser::binary,     PREC_EQUALITY};
+            r[GREATER]    = {nullptr,              &Parser::binary,     PREC_COMPARISON};
+            r[GR_EQUAL]   = {nullptr,              &Parser::binary,     PREC_COMPARISON};
+            r[LESS]       = {nullptr,              &Parser::binary,     PREC_COMPARISON};
+            r[LE_EQUAL]   = {nullptr,              &Parser::binary,     PREC_COMPARISON};
+            r[AND]        = {nullptr,              &Parser::binary,     PREC_AND};
+            r[OR]         = {nullptr,              &Parser::binary,     PREC_OR};
+            r[EQUAL]      = {nullptr,              &Parser::assignment, PREC_ASSIGNMENT};
+            r[IDENTIFIER] = {&Parser::variable,    nullptr,             PREC_NONE};
+            r[THIS]       = {&Parser::self,        nullptr,             PREC_NONE};
+            r[INTEGER]    = {&Parser::literal,     nullptr,             PREC_NONE};
+            r[STRING]     = {&Parser::literal,     nullptr,             PREC_NONE};
+            r[TRUE]       = {&Parser::literal,     nullptr,             PREC_NONE};
+            r[FALSE]      = {&Parser::literal,     nullptr,             PREC_NONE};
+            r[NUL]        = {&Parser::literal,     nullptr,             PREC_NONE};
+            return r;
+        }();
+        return rules[t];
+    }
+
+    //Parses an expression whose operators all bind at least as tightly as prec
+    Expr* parsePrecedence(Precedence prec) {
+        Expr* (Parser::*prefix)() = rule(peek().type).prefix;
+        if (prefix == nullptr) {
+            throw(new ParseError("Invalid token", peek().line));
         }
+        advance();
+        Expr* expr = (this->*prefix)();
 
-        return val;
-    }
-
-    Expr* logicalOr() {
-        Expr* expr = logicalAnd();
-        while (match(1,OR)){
-            Token op = previous();
-            Expr* right = logicalAnd();
-            expr = new Binary(expr, op, right);
+        while (prec <= rule(peek().type).precedence) {
+            advance();
+            expr = (this->*rule(previous().type).infix)(expr);
         }
 
         return expr;
     }
 
-    Expr* logicalAnd() {
-        Expr* expr = equality();
-        while (match(1,AND)){
-            Token op = previous();
-            Expr* right = equality();
-            expr = new Binary(expr, op, right);
-        }
+    //Infix rules - the operator has just been consumed
 
-        return expr;
+    Expr* binary(Expr* left) {
+        const Token& op = previous();
+        //Left associative, so the right operand only takes tighter operators
+        Expr* right = parsePrecedence((Precedence)(rule(op.type).precedence + 1));
+        return new Binary(left, op, right);
     }
 
-    Expr* equality() {
-        Expr* expr = comparison();
+    Expr* assignment(Expr* target) {
+        int line = previous().line;
 
-        while (match(2, ISN_EQUAL, IS_EQUAL)) {
-            Token op = previous();
-            Expr* right = comparison();
-            expr = new Binary(expr,op,right);
+        //Right associative since x=y=10 is allowed (recursive assignment)
+        Expr* right = parsePrecedence(PREC_ASSIGNMENT);
+        if (Get* get = dynamic_cast<Get*>(target)) {
+            return new Set(get->object, get->name, right);
+        } else if (Variable* lval = dynamic_cast<Variable*>(target)) {
+            return new Assignment(lval->name, right);
         }
-
-        return expr;
+        throw(new ParseError("Invalid assignment of non-udv", line));
     }
 
-    Expr* comparison() {
-        Expr* expr = term();
-        while (match(4, LE_EQUAL, GR_EQUAL, GREATER, LESS)) {
-            Token op = previous();
-            Expr* right = term();
-            expr = new Binary(expr,op,right);
-        }
-
-        return expr;
-    }
+    Expr* finishCall(Expr* expr) {
+        std::vector<Expr*> v;
 
-    Expr* term() {
-        Expr* expr = factor();
-        while (match(2,MINUS,PLUS)) {
-            Token op = previous();
-            Expr* right = factor();
-            expr = new Binary(expr,op,right);
+        if (!check(RIGHT_BR)) {
+            v.push_back(expression());
+            while (match(COMMA)){
+                v.push_back(expression());
+                if (v.size() >= 255) {
+                    throw(new ParseError("Too many arguements for function call", peek().line));
+                }
+            }
         }
 
-        return expr;
-    
+        const Token& bracket = consume(RIGHT_BR, "Expected ')' in call expression");
+        return new Call(expr, v, bracket);
     }
 
-    Expr* factor() {
-        Expr* expr = unary();
-        while (match(2,STAR,SLASH)) {
-            Token op = previous();
-            Expr* right = unary();
-            expr = new Binary(expr,op,right);
-        }
-
-        return expr;
+    Expr* dot(Expr* object) {
+        const Token& name = consume(IDENTIFIER, "Expected property name after '.'");
+        return new Get(object, name);
     }
 
-    Expr* unary(){
-        if (match(2,MINUS, EXL)) {
-            Token op = previous();
-            Expr* right = unary();
-            return new Unary(op, right); 
-        }
+    //Prefix rules - the first token has just been consumed
 
-        return call();
+    Expr* unary() {
+        const Token& op = previous();
+        Expr* right = parsePrecedence(PREC_UNARY);
+        return new Unary(op, right);
     }
 
-    Expr* call()  {
-        Expr* expr = primary();
-        while (true) {
-            //Encountered call token
-            if (match(1,LEFT_BR)) {
-                expr = finishCall(expr);
-            } else {
-                break;
-            }
-        }
-
-        return expr;
+    Expr* grouping() {
+        Expr* expr = expression();
+        consume(RIGHT_BR, "Expected a ')' after grouped expression");
+        return new Grouping(expr);
     }
 
-    Expr* finishCall(Expr* expr) {
-        std::vector<Expr*> v;
-
-        if (!check(RIGHT_BR)) {
-            v.push_back(expression());
-            while (match(1, COMMA)){
-                v.push_back(expression());
-                if (v.size() >= 255) {
-                    throw ParseError("Too many arguements for function call", tokens.at(current).line);
-                }
-            }
+    Expr* literal() {
+        switch (previous().type) {
+            case FALSE: return new Literal(false);
+            case TRUE: return new Literal(true);
+            case NUL: return new Literal(NULL);
+            default: return new Literal(previous().literal);
         }
+    }
 
+    Expr* variable() {
+        return new Variable(previous());
+    }
 
-        Token bracket = consume(RIGHT_BR, "Expected ')' in call expression");
-        return new Call(expr, v, bracket);
+    Expr* self() {
+        return new This(previous());
     }
 
-    Expr* primary() {
-        if (match(1, FALSE)) {
-            return new Literal(false);
-        } else if (match(1,TRUE)) {
-            return new Literal(true);
-        } else if (match(1,IDENTIFIER)) {
-            return new Variable(previous());
-        }else if (match(1,NUL)) {
-            return new Literal(NULL);
-        } else if (match(2,INTEGER,STRING)) {
-            return new Literal(previous().literal);
-        } else if (match(1,LEFT_BR)){
-            Expr* expr = expression();
-            consume(RIGHT_BR, "Expected a ')' after grouped expression");
-            return new Grouping(expr);
-        } else {
-            throw(new ParseError("Invalid token",tokens.at(current).line));
+    Expr* dictLiteral() {
+        const Token& brace = previous();
+        std::vector<Expr*> keys;
+        std::vector<Expr*> values;
+
+        if (!check(RIGHT_CURL)) {
+            do {
+                keys.push_back(expression());
+                consume(COLON, "Expected ':' after dictionary key");
+                values.push_back(expression());
+            } while (match(COMMA));
         }
+
+        consume(RIGHT_CURL, "Expected '}' after dictionary entries");
+        return new DictLiteral(keys, values, brace);
     }
 
 };
@@ -9,6 +9,8 @@
 #include "error.hpp"
 #include "token.hpp"
 #include "types.hpp"
+#include "hstring.hpp"
+#include "utils.hpp"
 
   
 class Scanner {
@@ -20,10 +22,15 @@ class Scanner {
 	int line;
 	int curr;
 	int start;
-	bool err = false;
+
+	//Bad characters are reported & skipped so one pass finds them all
+	std::vector<Err*> errors;
 	
 	std::map<std::string,TokenType> keywords;
 
+	//One string per distinct literal, so evaluating or comparing literals never copies bytes
+	std::map<std::string, HString> literals;
+
 	public:
 	Scanner(std::string src) {
 		this->src = src;
@@ -48,6 +55,8 @@ class Scanner {
 		keywords["true"] = TRUE;
 		keywords["return"] = RETURN;
 		keywords["func"] = FUNC;
+		keywords["this"] = THIS;
+		keywords["import"] = IMPORT;
 	}
 
 	std::vector<Token> scan() {
@@ -58,6 +67,11 @@ class Scanner {
 		return tokens;
 	}
 
+	//Errors found by scan(), owned by the caller
+	std::vector<Err*>& errs() {
+		return errors;
+	}
+
 	void evalToken() {
 		char c = forward();
 		switch (c) {
@@ -76,6 +90,7 @@ class Scanner {
 			//Connectors
 			case '.': addToken(DOT);break;
 			case ',': addToken(COMMA);break;
+			case ':': addToken(COLON);break;
 
 			//HEAD
 			case '@':  addToken(AT);break;
@@ -100,7 +115,7 @@ class Scanner {
 				} else if (isalpha(c)) {
 					handleId();
 				} else {
-					throw(new UnexpectedSequence(line,src.substr(start,curr-start)));
+					errors.push_back(new UnexpectedSequence(line,src.substr(start,curr-start)));
 				}
 		}
 	}
@@ -152,13 +167,29 @@ class Scanner {
 
 		while (next() != '"'){
 			if (atEnd()){
-				throw(new UnexpectedSequence(line,src.substr(start,curr-start)));
+				//Unterminated string - nothing left to scan after it
+				errors.push_back(new UnexpectedSequence(line,src.substr(start,curr-start)));
+				return;
 			}
-			lit += forward();
+			char c = forward();
+			if (c == '\n') {
+				line++;
+			} else if (c == '\\' && !atEnd()) {
+				//Escapes
+				char e = forward();
+				switch (e) {
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case '"': c = '"'; break;
+					case '\\': c = '\\'; break;
+					default: lit += c; c = e;
+				}
+			}
+			lit += c;
 		}
 		forward();
 
-		addToken(STRING, std::string(lit));
+		addToken(STRING, literals.try_emplace(lit, lit, true).first->second);
 	}
 
 	void handleInt(){
@@ -172,7 +203,15 @@ class Scanner {
 				forward();
 			}
 		}
-		addToken(INTEGER, double(stod(src.substr(start,curr-start))));
+		//Whole numbers are integers unless too big for one
+		std::string digits = src.substr(start,curr-start);
+		if (digits.find('.') == std::string::npos) {
+			try {
+				addToken(INTEGER, HInt(std::stoll(digits)));
+				return;
+			} catch (std::out_of_range& e) {}
+		}
+		addToken(INTEGER, double(stod(digits)));
 	}
 
 	void handleId() {
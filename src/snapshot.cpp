@@ -0,0 +1,878 @@
+#include <map>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.hpp"
+#include "visitor.hpp"
+
+namespace huff {
+    static const char MAGIC[8] = {'H', 'U', 'F', 'F', 'I', 'M', 'G', '2'};
+    //Object references that aren't an index into the image's object table
+    static const uint32_t NO_OBJECT = UINT32_MAX;
+    static const uint32_t GLOBAL_ENV = UINT32_MAX - 1;
+
+    enum StmtTag : uint8_t {
+        S_NONE, S_PRINT, S_VAR, S_BLOCK, S_CONDITIONAL, S_WHILE, S_FUNC, S_FUNC_REF, S_CLASS,
+        S_CLASS_REF, S_EXPRESSION, S_RETURN, S_IMPORT
+    };
+
+    enum ExprTag : uint8_t {
+        E_NONE, E_BINARY, E_ASSIGNMENT, E_LITERAL, E_VARIABLE, E_GROUPING, E_CALL, E_UNARY, E_GET,
+        E_SET, E_THIS, E_DICT, E_NUM_BINARY, E_NUM_UNARY
+    };
+
+    enum ValueTag : uint8_t {
+        V_NONE, V_NUL, V_FALSE, V_TRUE, V_INT, V_DOUBLE, V_STRING, V_OBJECT, V_NATIVE
+    };
+
+    enum ObjectKind : uint8_t {
+        O_ENV, O_UPVALUE, O_FUNCTION, O_CLASS, O_INSTANCE, O_DICT, O_BOUND, O_MODULE
+    };
+
+    size_t setupLength(const std::vector<Stmt*>& stmts) {
+        size_t n = 0;
+        while (n < stmts.size() && (dynamic_cast<Var*>(stmts[n]) || dynamic_cast<Func*>(stmts[n])
+            || dynamic_cast<Class*>(stmts[n]) || dynamic_cast<Import*>(stmts[n]))) {
+            n++;
+        }
+        return n;
+    }
+
+    //Writing
+
+    class SnapshotWriter {
+        Interpreter* i;
+        std::string out;
+        std::map<Func*, uint32_t> funcs;
+        std::map<Class*, uint32_t> classes;
+        std::map<GcObject*, uint32_t> ids;
+        std::vector<std::pair<ObjectKind, GcObject*>> objects;
+        //Name of each native in a new interpreter's globals
+        std::map<HCallable*, std::string> natives;
+
+        void u8(uint8_t v) { out += (char)v; }
+        void u32(uint32_t v) { out.append((const char*)&v, sizeof(v)); }
+        void i64(int64_t v) { out.append((const char*)&v, sizeof(v)); }
+        void f64(double v) { out.append((const char*)&v, sizeof(v)); }
+
+        void str(std::string_view s) {
+            u32(s.size());
+            out.append(s);
+        }
+
+        void token(const Token& t) {
+            u32(t.type);
+            str(t.lexeme);
+            u32(t.line);
+        }
+
+        void tokens(const std::vector<Token>& ts) {
+            u32(ts.size());
+            for (const Token& t : ts) token(t);
+        }
+
+        void stmts(const std::vector<Stmt*>& ss) {
+            u32(ss.size());
+            for (Stmt* s : ss) stmt(s);
+        }
+
+        void exprs(const std::vector<Expr*>& es) {
+            u32(es.size());
+            for (Expr* e : es) expr(e);
+        }
+
+        //Functions & classes are written once, then referred to by index - closures of one function
+        //share its tree, and a function's tree may be written as part of another's
+        void func(Func* f) {
+            auto found = funcs.find(f);
+            if (found != funcs.end()) {
+                u8(S_FUNC_REF);
+                u32(found->second);
+                return;
+            }
+            uint32_t id = funcs.size();
+            funcs[f] = id;
+            u8(S_FUNC);
+            token(f->name);
+            tokens(f->params);
+            u8(f->memo);
+            i64(f->memoLimit);
+            u32(f->captures.size());
+            for (const Capture& c : f->captures) {
+                str(c.name);
+                u8(c.local);
+                u32(c.hops);
+                u32(c.index);
+                u8(c.forward);
+            }
+            stmts(f->body);
+        }
+
+        void klass(Class* c) {
+            auto found = classes.find(c);
+            if (found != classes.end()) {
+                u8(S_CLASS_REF);
+                u32(found->second);
+                return;
+            }
+            uint32_t id = classes.size();
+            classes[c] = id;
+            u8(S_CLASS);
+            token(c->name);
+            u32(c->methods.size());
+            for (Func* m : c->methods) func(m);
+        }
+
+        void stmt(Stmt* s) {
+            if (s == nullptr) {
+                u8(S_NONE);
+            } else if (Print* p = dynamic_cast<Print*>(s)) {
+                u8(S_PRINT);
+                expr(p->expression);
+            } else if (Var* v = dynamic_cast<Var*>(s)) {
+                u8(S_VAR);
+                token(v->name);
+                expr(v->initialiser);
+            } else if (Block* b = dynamic_cast<Block*>(s)) {
+                u8(S_BLOCK);
+                stmts(b->statements);
+            } else if (Conditional* c = dynamic_cast<Conditional*>(s)) {
+                u8(S_CONDITIONAL);
+                expr(c->condition);
+                stmt(c->thenBranch);
+                u32(c->elfs.size());
+                for (Conditional* elf : c->elfs) stmt(elf);
+                stmt(c->elseBranch);
+            } else if (CWhile* w = dynamic_cast<CWhile*>(s)) {
+                u8(S_WHILE);
+                expr(w->condition);
+                stmt(w->body);
+                token(w->keyword);
+            } else if (Func* f = dynamic_cast<Func*>(s)) {
+                func(f);
+            } else if (Class* c = dynamic_cast<Class*>(s)) {
+                klass(c);
+            } else if (Expression* e = dynamic_cast<Expression*>(s)) {
+                u8(S_EXPRESSION);
+                expr(e->expression);
+            } else if (Return* r = dynamic_cast<Return*>(s)) {
+                u8(S_RETURN);
+                expr(r->returnVal);
+            } else if (Import* m = dynamic_cast<Import*>(s)) {
+                u8(S_IMPORT);
+                token(m->keyword);
+                tokens(m->path);
+                str(m->file);
+            }
+        }
+
+        void expr(Expr* e) {
+            if (e == nullptr) {
+                u8(E_NONE);
+            } else if (Binary* b = dynamic_cast<Binary*>(e)) {
+                u8(E_BINARY);
+                expr(b->left);
+                token(b->op);
+                expr(b->right);
+            } else if (Assignment* a = dynamic_cast<Assignment*>(e)) {
+                u8(E_ASSIGNMENT);
+                token(a->name);
+                expr(a->expression);
+                u32(a->upvalue);
+            } else if (Literal* l = dynamic_cast<Literal*>(e)) {
+                u8(E_LITERAL);
+                value(l->value);
+            } else if (Variable* v = dynamic_cast<Variable*>(e)) {
+                u8(E_VARIABLE);
+                token(v->name);
+                u32(v->upvalue);
+            } else if (Grouping* g = dynamic_cast<Grouping*>(e)) {
+                u8(E_GROUPING);
+                expr(g->value);
+            } else if (Call* c = dynamic_cast<Call*>(e)) {
+                u8(E_CALL);
+                expr(c->callee);
+                exprs(c->args);
+                token(c->paren);
+            } else if (Unary* u = dynamic_cast<Unary*>(e)) {
+                u8(E_UNARY);
+                token(u->op);
+                expr(u->right);
+            } else if (Get* g = dynamic_cast<Get*>(e)) {
+                u8(E_GET);
+                expr(g->object);
+                token(g->name);
+            } else if (Set* s = dynamic_cast<Set*>(e)) {
+                u8(E_SET);
+                expr(s->object);
+                token(s->name);
+                expr(s->value);
+            } else if (This* t = dynamic_cast<This*>(e)) {
+                u8(E_THIS);
+                token(t->keyword);
+                u32(t->upvalue);
+            } else if (DictLiteral* d = dynamic_cast<DictLiteral*>(e)) {
+                u8(E_DICT);
+                exprs(d->keys);
+                exprs(d->values);
+                token(d->brace);
+            } else if (NumBinary* n = dynamic_cast<NumBinary*>(e)) {
+                u8(E_NUM_BINARY);
+                expr(n->left);
+                token(n->op);
+                expr(n->right);
+                u8(n->leftKind);
+                u8(n->rightKind);
+            } else if (NumUnary* n = dynamic_cast<NumUnary*>(e)) {
+                u8(E_NUM_UNARY);
+                token(n->op);
+                expr(n->right);
+                u8(n->kind);
+            }
+        }
+
+        void value(const std::any& v) {
+            const std::type_info& t = v.type();
+            if (!v.has_value()) {
+                u8(V_NONE);
+            } else if (t == typeid(long)) {
+                u8(V_NUL);
+            } else if (t == typeid(bool)) {
+                u8(std::any_cast<bool>(v) ? V_TRUE : V_FALSE);
+            } else if (t == typeid(HInt)) {
+                u8(V_INT);
+                i64(std::any_cast<HInt>(v));
+            } else if (t == typeid(double)) {
+                u8(V_DOUBLE);
+                f64(std::any_cast<double>(v));
+            } else if (t == typeid(HString)) {
+                u8(V_STRING);
+                str(std::any_cast<const HString&>(v).view());
+            } else if (t == typeid(HCallable*) && std::any_cast<HCallable*>(v)->native) {
+                u8(V_NATIVE);
+                str(natives.at(std::any_cast<HCallable*>(v)));
+            } else {
+                u8(V_OBJECT);
+                ref(object(v));
+            }
+        }
+
+        void ref(GcObject* o) {
+            if (o == nullptr) {
+                u32(NO_OBJECT);
+            } else if (o == i->global) {
+                u32(GLOBAL_ENV);
+            } else {
+                u32(ids.at(o));
+            }
+        }
+
+        //The object a value refers to
+        GcObject* object(const std::any& v) {
+            const std::type_info& t = v.type();
+            if (t == typeid(HCallable*)) return std::any_cast<HCallable*>(v);
+            if (t == typeid(Instance*)) return std::any_cast<Instance*>(v);
+            if (t == typeid(Dict*)) return std::any_cast<Dict*>(v);
+            if (t == typeid(Module*)) return std::any_cast<Module*>(v);
+            return nullptr;
+        }
+
+        //Gives every object reachable from v an index, failing on any that can't be saved
+        void collect(const std::any& v, const std::string& global) {
+            const std::type_info& t = v.type();
+            if (t == typeid(HFile*)) {
+                throw new RuntimeError("Can't snapshot " + global + " - it holds a file", 0);
+            } else if (t == typeid(Future*)) {
+                throw new RuntimeError("Can't snapshot " + global + " - it holds a future", 0);
+            } else if (t == typeid(JsonDoc*)) {
+                throw new RuntimeError("Can't snapshot " + global + " - it holds a JSON document", 0);
+            } else if (t == typeid(HCallable*)) {
+                HCallable* c = std::any_cast<HCallable*>(v);
+                if (dynamic_cast<UDCallable*>(c)) {
+                    add(O_FUNCTION, c);
+                } else if (dynamic_cast<HClass*>(c)) {
+                    add(O_CLASS, c);
+                } else if (dynamic_cast<BoundMethod*>(c)) {
+                    add(O_BOUND, c);
+                } else if (natives.count(c) == 0) {
+                    throw new RuntimeError("Can't snapshot " + global + " - it holds a host function", 0);
+                }
+            } else if (t == typeid(Instance*)) {
+                add(O_INSTANCE, std::any_cast<Instance*>(v));
+            } else if (t == typeid(Dict*)) {
+                add(O_DICT, std::any_cast<Dict*>(v));
+            } else if (t == typeid(Module*)) {
+                add(O_MODULE, std::any_cast<Module*>(v));
+            }
+        }
+
+        void add(ObjectKind kind, GcObject* o) {
+            if (o == nullptr || o == i->global || ids.count(o) != 0) return;
+            ids[o] = objects.size();
+            objects.push_back({kind, o});
+        }
+
+        //Adds what objects[n] refers to
+        void children(size_t n, const std::string& global) {
+            auto [kind, o] = objects[n];
+            if (kind == O_ENV) {
+                Enviroment* env = (Enviroment*)o;
+                add(O_ENV, env->enclosing);
+                env->each([&](const std::string& name, std::any& v) { collect(v, global); });
+            } else if (kind == O_UPVALUE) {
+                collect(*((Upvalue*)o)->location, global);
+            } else if (kind == O_FUNCTION) {
+                UDCallable* f = (UDCallable*)o;
+                add(O_ENV, f->globals);
+                for (Upvalue* up : f->upvalues) add(O_UPVALUE, up);
+            } else if (kind == O_CLASS) {
+                for (auto& m : ((HClass*)o)->methods) add(O_FUNCTION, m.second);
+            } else if (kind == O_INSTANCE) {
+                Instance* in = (Instance*)o;
+                add(O_CLASS, in->klass);
+                for (std::any& v : in->slots) collect(v, global);
+            } else if (kind == O_DICT) {
+                ((Dict*)o)->table.each([&](const DictKey& key, std::any& v) { collect(v, global); });
+            } else if (kind == O_BOUND) {
+                BoundMethod* b = (BoundMethod*)o;
+                add(O_FUNCTION, b->method);
+                add(O_INSTANCE, b->self);
+            }
+        }
+
+        void contents(ObjectKind kind, GcObject* o) {
+            if (kind == O_ENV) {
+                Enviroment* env = (Enviroment*)o;
+                ref(env->enclosing);
+                entries(env);
+            } else if (kind == O_UPVALUE) {
+                value(*((Upvalue*)o)->location);
+            } else if (kind == O_FUNCTION) {
+                UDCallable* f = (UDCallable*)o;
+                ref(f->globals);
+                u32(f->upvalues.size());
+                for (Upvalue* up : f->upvalues) ref(up);
+            } else if (kind == O_CLASS) {
+                HClass* c = (HClass*)o;
+                u32(c->expectedSlots.load());
+                u32(c->methods.size());
+                for (auto& m : c->methods) {
+                    str(m.first);
+                    ref(m.second);
+                }
+            } else if (kind == O_INSTANCE) {
+                Instance* in = (Instance*)o;
+                ref(in->klass);
+                u32(in->slots.size());
+                for (size_t s = 0; s < in->slots.size(); s++) {
+                    str(in->shape->fields[s]);
+                    value(in->slots[s]);
+                }
+            } else if (kind == O_DICT) {
+                Dict* d = (Dict*)o;
+                u32(d->table.size());
+                d->table.each([&](const DictKey& key, std::any& v) {
+                    value(key.toValue());
+                    value(v);
+                });
+            } else if (kind == O_BOUND) {
+                BoundMethod* b = (BoundMethod*)o;
+                ref(b->method);
+                ref(b->self);
+            }
+        }
+
+        //Values defined in env - the global one leaves out natives still under their own name
+        void entries(Enviroment* env) {
+            std::vector<std::pair<std::string, std::any*>> kept;
+            env->each([&](const std::string& name, std::any& v) {
+                auto native = v.type() == typeid(HCallable*) ? natives.find(std::any_cast<HCallable*>(v)) : natives.end();
+                if (env == i->global && native != natives.end() && native->second == name) return;
+                kept.push_back({name, &v});
+            });
+            u32(kept.size());
+            for (auto& [name, v] : kept) {
+                str(name);
+                value(*v);
+            }
+        }
+
+        public:
+        SnapshotWriter(Interpreter* i) : i(i) {
+            //A native is saved by the name a new interpreter defines it under
+            Interpreter fresh;
+            fresh.global->each([&](const std::string& name, std::any& builtin) {
+                std::any* mine = i->global->find(name);
+                if (mine != nullptr && mine->type() == typeid(HCallable*) && std::any_cast<HCallable*>(*mine)->native
+                    && typeid(*std::any_cast<HCallable*>(*mine)) == typeid(*std::any_cast<HCallable*>(builtin))) {
+                    natives[std::any_cast<HCallable*>(*mine)] = name;
+                }
+            });
+        }
+
+        std::string write(const std::vector<Stmt*>& rest) {
+            //Objects are found breadth first from each global in turn, so an error can name the
+            //global that reaches the object that can't be saved
+            size_t done = 0;
+            i->global->each([&](const std::string& name, std::any& v) {
+                collect(v, name);
+                for (; done < objects.size(); done++) {
+                    children(done, name);
+                }
+            });
+
+            out.append(MAGIC, sizeof(MAGIC));
+
+            //Trees of every function & class the objects use, then the statements to run
+            u32(objects.size());
+            for (auto& [kind, o] : objects) {
+                if (kind == O_FUNCTION) {
+                    func(((UDCallable*)o)->declaration);
+                } else if (kind == O_CLASS) {
+                    klass(((HClass*)o)->declaration);
+                } else {
+                    stmt(nullptr);
+                }
+            }
+            stmts(rest);
+
+            //Objects are made first, then filled in, so they can refer to each other
+            u32(objects.size());
+            for (auto& [kind, o] : objects) {
+                u8(kind);
+                if (kind == O_ENV) {
+                    u8(((Enviroment*)o)->isFunc);
+                } else if (kind == O_MODULE) {
+                    str(((Module*)o)->file);
+                    str(((Module*)o)->name);
+                }
+            }
+            for (auto& [kind, o] : objects) {
+                contents(kind, o);
+            }
+            entries(i->global);
+            return std::move(out);
+        }
+    };
+
+    void writeSnapshot(Interpreter* i, const std::vector<Stmt*>& rest, const std::string& path) {
+        std::string image = SnapshotWriter(i).write(rest);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(image.data(), image.size());
+        if (!file) {
+            throw new RuntimeError("Can't write snapshot to " + path, 0);
+        }
+    }
+
+    //Reading
+
+    class SnapshotReader {
+        Interpreter* i;
+        std::string path;
+        //The whole image - strings in it are used where they lie rather than copied
+        std::shared_ptr<MappedBuf> image;
+        size_t at = sizeof(MAGIC);
+        std::vector<Func*> funcs;
+        std::vector<Class*> classes;
+        //Tree of each object that has one (functions & classes)
+        struct Declaration {
+            Func* func = nullptr;
+            Class* klass = nullptr;
+        };
+        std::vector<Declaration> declarations;
+        std::vector<GcObject*> objects;
+        std::map<std::string, std::any> natives;
+
+        void need(size_t bytes) {
+            if (image->mappedSize - at < bytes) {
+                throw new RuntimeError("Snapshot " + path + " is truncated", 0);
+            }
+        }
+
+        template<typename T> T fixed() {
+            need(sizeof(T));
+            T v;
+            memcpy(&v, image->external + at, sizeof(T));
+            at += sizeof(T);
+            return v;
+        }
+
+        uint8_t u8() { return fixed<uint8_t>(); }
+        uint32_t u32() { return fixed<uint32_t>(); }
+
+        //A count of entries to follow - each takes at least a byte, so a count past the end is caught before anything is sized by it
+        uint32_t count() {
+            uint32_t n = u32();
+            need(n);
+            return n;
+        }
+
+        std::string_view view() {
+            uint32_t size = u32();
+            need(size);
+            std::string_view s(image->external + at, size);
+            at += size;
+            return s;
+        }
+
+        std::string str() {
+            return std::string(view());
+        }
+
+        Token token() {
+            TokenType type = (TokenType)u32();
+            std::string lexeme = str();
+            int line = u32();
+            return Token(type, lexeme, std::any(), line);
+        }
+
+        std::vector<Token> tokens() {
+            std::vector<Token> ts(count());
+            for (Token& t : ts) t = token();
+            return ts;
+        }
+
+        std::vector<Stmt*> stmts() {
+            std::vector<Stmt*> ss(count());
+            for (Stmt*& s : ss) s = stmt();
+            return ss;
+        }
+
+        std::vector<Expr*> exprs() {
+            std::vector<Expr*> es(count());
+            for (Expr*& e : es) e = expr();
+            return es;
+        }
+
+        void corrupt() {
+            throw new RuntimeError("Snapshot " + path + " is corrupt", 0);
+        }
+
+        template<typename T> T* indexed(std::vector<T*>& nodes) {
+            uint32_t id = u32();
+            if (id >= nodes.size() || nodes[id] == nullptr) corrupt();
+            return nodes[id];
+        }
+
+        Func* func() {
+            size_t id = funcs.size();
+            funcs.push_back(nullptr);
+            Token name = token();
+            std::vector<Token> params = tokens();
+            bool memo = u8();
+            size_t memoLimit = fixed<int64_t>();
+            std::vector<Capture> captures(count());
+            for (Capture& c : captures) {
+                c.name = str();
+                c.local = u8();
+                c.hops = u32();
+                c.index = u32();
+                c.forward = u8();
+            }
+            Func* f = new Func(name, params, stmts());
+            f->memo = memo;
+            f->memoLimit = memoLimit;
+            f->captures = captures;
+            funcs[id] = f;
+            return f;
+        }
+
+        Class* klass() {
+            size_t id = classes.size();
+            classes.push_back(nullptr);
+            Token name = token();
+            std::vector<Func*> methods(count());
+            for (Func*& m : methods) {
+                m = dynamic_cast<Func*>(stmt());
+                if (m == nullptr) corrupt();
+            }
+            classes[id] = new Class(name, methods);
+            return classes[id];
+        }
+
+        Stmt* stmt() {
+            switch (u8()) {
+                case S_NONE: return nullptr;
+                case S_PRINT: return new Print(expr());
+                case S_VAR: {
+                    Token name = token();
+                    return new Var(name, expr());
+                }
+                case S_BLOCK: return new Block(stmts());
+                case S_CONDITIONAL: {
+                    Expr* condition = expr();
+                    Stmt* then = stmt();
+                    std::vector<Conditional*> elfs(count());
+                    for (Conditional*& elf : elfs) {
+                        elf = dynamic_cast<Conditional*>(stmt());
+                        if (elf == nullptr) corrupt();
+                    }
+                    return new Conditional(condition, then, elfs, stmt());
+                }
+                case S_WHILE: {
+                    Expr* condition = expr();
+                    Stmt* body = stmt();
+                    return new CWhile(condition, body, token());
+                }
+                case S_FUNC: return func();
+                case S_FUNC_REF: return indexed(funcs);
+                case S_CLASS: return klass();
+                case S_CLASS_REF: return indexed(classes);
+                case S_EXPRESSION: return new Expression(expr());
+                case S_RETURN: return new Return(expr());
+                case S_IMPORT: {
+                    Token keyword = token();
+                    Import* m = new Import(keyword, tokens());
+                    m->file = str();
+                    return m;
+                }
+            }
+            corrupt();
+            return nullptr;
+        }
+
+        Expr* expr() {
+            switch (u8()) {
+                case E_NONE: return nullptr;
+                case E_BINARY: {
+                    Expr* left = expr();
+                    Token op = token();
+                    return new Binary(left, op, expr());
+                }
+                case E_ASSIGNMENT: {
+                    Token name = token();
+                    Assignment* a = new Assignment(name, expr());
+                    a->upvalue = (int)u32();
+                    return a;
+                }
+                case E_LITERAL: return new Literal(value());
+                case E_VARIABLE: {
+                    Variable* v = new Variable(token());
+                    v->upvalue = (int)u32();
+                    return v;
+                }
+                case E_GROUPING: return new Grouping(expr());
+                case E_CALL: {
+                    Expr* callee = expr();
+                    std::vector<Expr*> args = exprs();
+                    return new Call(callee, args, token());
+                }
+                case E_UNARY: {
+                    Token op = token();
+                    return new Unary(op, expr());
+                }
+                case E_GET: {
+                    Expr* object = expr();
+                    return new Get(object, token());
+                }
+                case E_SET: {
+                    Expr* object = expr();
+                    Token name = token();
+                    return new Set(object, name, expr());
+                }
+                case E_THIS: {
+                    This* t = new This(token());
+                    t->upvalue = (int)u32();
+                    return t;
+                }
+                case E_DICT: {
+                    std::vector<Expr*> keys = exprs();
+                    std::vector<Expr*> values = exprs();
+                    return new DictLiteral(keys, values, token());
+                }
+                case E_NUM_BINARY: {
+                    Expr* left = expr();
+                    Token op = token();
+                    NumBinary* n = new NumBinary(left, op, expr());
+                    n->leftKind = (NumKind)u8();
+                    n->rightKind = (NumKind)u8();
+                    return n;
+                }
+                case E_NUM_UNARY: {
+                    Token op = token();
+                    NumUnary* n = new NumUnary(op, expr());
+                    n->kind = (NumKind)u8();
+                    return n;
+                }
+            }
+            corrupt();
+            return nullptr;
+        }
+
+        std::any value() {
+            switch (u8()) {
+                case V_NONE: return std::any();
+                case V_NUL: return NULL;
+                case V_FALSE: return false;
+                case V_TRUE: return true;
+                case V_INT: return (HInt)fixed<int64_t>();
+                case V_DOUBLE: return fixed<double>();
+                case V_STRING: {
+                    std::string_view s = view();
+                    return HString(image, s.data() - image->external, s.size());
+                }
+                case V_NATIVE: {
+                    auto found = natives.find(str());
+                    if (found == natives.end()) corrupt();
+                    return found->second;
+                }
+                case V_OBJECT: {
+                    GcObject* o = ref();
+                    if (HCallable* c = dynamic_cast<HCallable*>(o)) return c;
+                    if (Instance* in = dynamic_cast<Instance*>(o)) return in;
+                    if (Dict* d = dynamic_cast<Dict*>(o)) return d;
+                    if (Module* m = dynamic_cast<Module*>(o)) return m;
+                }
+            }
+            corrupt();
+            return std::any();
+        }
+
+        GcObject* ref() {
+            uint32_t id = u32();
+            if (id == NO_OBJECT) return nullptr;
+            if (id == GLOBAL_ENV) return i->global;
+            if (id >= objects.size()) corrupt();
+            return objects[id];
+        }
+
+        template<typename T> T* ref() {
+            GcObject* o = ref();
+            T* typed = dynamic_cast<T*>(o);
+            if (o != nullptr && typed == nullptr) corrupt();
+            return typed;
+        }
+
+        void entries(Enviroment* env) {
+            for (uint32_t n = u32(); n > 0; n--) {
+                std::string name = str();
+                env->define(name, value());
+            }
+        }
+
+        void contents(GcObject* o) {
+            if (Enviroment* env = dynamic_cast<Enviroment*>(o)) {
+                env->enclosing = ref<Enviroment>();
+                entries(env);
+            } else if (Upvalue* up = dynamic_cast<Upvalue*>(o)) {
+                up->closed = value();
+            } else if (UDCallable* f = dynamic_cast<UDCallable*>(o)) {
+                f->globals = ref<Enviroment>();
+                f->upvalues.resize(count());
+                for (Upvalue*& up : f->upvalues) up = ref<Upvalue>();
+            } else if (HClass* c = dynamic_cast<HClass*>(o)) {
+                c->expectedSlots = u32();
+                for (uint32_t n = u32(); n > 0; n--) {
+                    std::string name = str();
+                    c->methods[name] = ref<UDCallable>();
+                }
+            } else if (Instance* in = dynamic_cast<Instance*>(o)) {
+                in->klass = ref<HClass>();
+                if (in->klass == nullptr) corrupt();
+                in->shape = in->klass->root;
+                uint32_t n = count();
+                in->slots.reserve(n);
+                for (; n > 0; n--) {
+                    in->shape = in->shape->with(str());
+                    in->slots.push_back(value());
+                }
+                i->heap.charge(in, in->slots.size() * sizeof(std::any));
+            } else if (Dict* d = dynamic_cast<Dict*>(o)) {
+                uint32_t n = count();
+                d->reserve(n);
+                for (; n > 0; n--) {
+                    DictKey key = toKey(value(), 0);
+                    d->set(key, value());
+                }
+            } else if (BoundMethod* b = dynamic_cast<BoundMethod*>(o)) {
+                b->method = ref<UDCallable>();
+                b->self = ref<Instance>();
+            }
+        }
+
+        GcObject* make(ObjectKind kind, size_t n) {
+            switch (kind) {
+                case O_ENV: return i->heap.make<Enviroment>((bool)u8());
+                case O_UPVALUE: return i->heap.make<Upvalue>(std::any());
+                case O_FUNCTION: {
+                    if (declarations[n].func == nullptr) corrupt();
+                    return i->heap.make<UDCallable>(declarations[n].func, i->global);
+                }
+                case O_CLASS: {
+                    if (declarations[n].klass == nullptr) corrupt();
+                    return i->heap.make<HClass>(declarations[n].klass);
+                }
+                case O_INSTANCE: return i->heap.make<Instance>(nullptr, nullptr, 0);
+                case O_DICT: return i->heap.make<Dict>();
+                case O_BOUND: return i->heap.make<BoundMethod>(nullptr, nullptr);
+                case O_MODULE: {
+                    std::string file = str();
+                    return i->heap.make<Module>(file, str());
+                }
+            }
+            corrupt();
+            return nullptr;
+        }
+
+        public:
+        SnapshotReader(Interpreter* i, const std::string& path) : i(i), path(path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw new RuntimeError("Can't open snapshot " + path, 0);
+            }
+            struct stat info;
+            void* mapped = MAP_FAILED;
+            if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(MAGIC)) {
+                mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            close(fd);
+            if (mapped == MAP_FAILED) {
+                throw new RuntimeError("Can't read snapshot " + path, 0);
+            }
+            image = std::make_shared<MappedBuf>((const char*)mapped, info.st_size);
+            if (memcmp(image->external, MAGIC, sizeof(MAGIC)) != 0) {
+                throw new RuntimeError(path + " isn't a huffle snapshot (or is from another version)", 0);
+            }
+
+            i->global->each([&](const std::string& name, std::any& v) {
+                natives[name] = v;
+            });
+        }
+
+        std::vector<Stmt*> read() {
+            declarations.resize(count());
+            for (Declaration& d : declarations) {
+                Stmt* s = stmt();
+                d.func = dynamic_cast<Func*>(s);
+                d.klass = dynamic_cast<Class*>(s);
+            }
+            std::vector<Stmt*> rest = stmts();
+
+            //Everything made stays rooted until the globals are restored
+            RootScope scope(i->heap);
+            uint32_t made = count();
+            if (made != declarations.size()) corrupt();
+            objects.reserve(made);
+            for (size_t n = 0; n < made; n++) {
+                GcObject* o = make((ObjectKind)u8(), n);
+                i->heap.pushRoot(o);
+                objects.push_back(o);
+            }
+            for (GcObject* o : objects) {
+                contents(o);
+            }
+            entries(i->global);
+            i->heap.settle();
+            return rest;
+        }
+    };
+
+    std::vector<Stmt*> readSnapshot(Interpreter* i, const std::string& path) {
+        return SnapshotReader(i, path).read();
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "hcall.hpp"
+
+//Startup images - a program's globals after its top level setup, saved to a file and mapped
+//back in by later runs, so they start where the setup left off instead of re-running it.
+//
+//Setup is the leading run of declarations at the top level (udv, func, class & import) - the
+//program's first other statement & everything after it run each time the image is loaded.
+//An image holds the globals' values (numbers, strings, dictionaries, instances, functions,
+//classes & closures, with their sharing & cycles kept), the syntax trees of every function &
+//class they use, and the statements still to run - so it never needs the program's source.
+//Files, futures & JSON documents can't be saved, and memo caches start empty.
+namespace huff {
+    //Number of leading statements that are setup
+    size_t setupLength(const std::vector<Stmt*>& stmts);
+
+    //Writes i's globals, and rest (the statements after setup), to path
+    void writeSnapshot(Interpreter* i, const std::vector<Stmt*>& rest, const std::string& path);
+
+    //Restores an image's globals into i, a new interpreter - returns the statements to run
+    std::vector<Stmt*> readSnapshot(Interpreter* i, const std::string& path);
+}
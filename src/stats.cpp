@@ -0,0 +1,136 @@
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "stats.hpp"
+
+namespace huff::stats {
+    //Never freed - pool workers detach as the process exits, after statics are destroyed
+    static std::mutex& lock() {
+        static auto* lock = new std::mutex();
+        return *lock;
+    }
+
+    static std::vector<Counters*>& threads() {
+        static auto* threads = new std::vector<Counters*>();
+        return *threads;
+    }
+
+    static Counters& retired() {
+        static auto* retired = new Counters();
+        return *retired;
+    }
+
+    #ifdef HUFFLE_STATS
+    //Registers a thread's counters for as long as it runs, then folds them into retired()
+    struct Attached {
+        Attached() {
+            std::lock_guard<std::mutex> hold(lock());
+            threads().push_back(&local);
+        }
+
+        ~Attached() {
+            std::lock_guard<std::mutex> hold(lock());
+            retired().add(local);
+            threads().erase(std::find(threads().begin(), threads().end(), &local));
+        }
+    };
+
+    void attach() {
+        thread_local Attached attached;
+    }
+    #else
+    void attach() {}
+    #endif
+
+    Counters total() {
+        std::lock_guard<std::mutex> hold(lock());
+        Counters sum = retired();
+        for (Counters* c : threads()) {
+            sum.add(*c);
+        }
+        return sum;
+    }
+
+    Format formatFor(const std::string& path) {
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        return json ? JSON : PROMETHEUS;
+    }
+
+    static double ms(uint64_t ns) {
+        return ns / 1e6;
+    }
+
+    static double averageDepth(const Counters& c) {
+        return c.lookups == 0 ? 0 : (double)c.lookupDepth / c.lookups;
+    }
+
+    static void text(const Counters& c, std::ostream& out) {
+        out << "-- huffle stats --\n";
+        out << "scan " << ms(c.scanNs) << " ms, parse " << ms(c.parseNs) << " ms, run " << ms(c.runNs) << " ms\n";
+        out << "nodes visited:\n";
+        for (int n = 0; n < NODE_KINDS; n++) {
+            if (c.nodes[n] != 0) out << "  " << nodeNames[n] << " " << c.nodes[n] << "\n";
+        }
+        out << "enviroments created " << c.enviroments << "\n";
+        out << "variable lookups " << c.lookups << " (average chain depth " << averageDepth(c) << ")\n";
+        out << "user calls " << c.userCalls << ", native calls " << c.nativeCalls << "\n";
+        out << "runtime errors thrown " << c.errors << "\n";
+        out << "bytes allocated " << c.bytes << "\n";
+    }
+
+    static void json(const Counters& c, std::ostream& out) {
+        out << "{\n  \"nodes\": {";
+        for (int n = 0; n < NODE_KINDS; n++) {
+            out << (n == 0 ? "" : ",") << "\n    \"" << nodeNames[n] << "\": " << c.nodes[n];
+        }
+        out << "\n  },\n";
+        out << "  \"enviroments\": " << c.enviroments << ",\n";
+        out << "  \"lookups\": " << c.lookups << ",\n";
+        out << "  \"lookup_average_depth\": " << averageDepth(c) << ",\n";
+        out << "  \"native_calls\": " << c.nativeCalls << ",\n";
+        out << "  \"user_calls\": " << c.userCalls << ",\n";
+        out << "  \"errors\": " << c.errors << ",\n";
+        out << "  \"bytes_allocated\": " << c.bytes << ",\n";
+        out << "  \"scan_ms\": " << ms(c.scanNs) << ",\n";
+        out << "  \"parse_ms\": " << ms(c.parseNs) << ",\n";
+        out << "  \"run_ms\": " << ms(c.runNs) << "\n}\n";
+    }
+
+    static void counter(std::ostream& out, const std::string& name, const std::string& help, const std::string& type) {
+        out << "# HELP huffle_" << name << " " << help << "\n# TYPE huffle_" << name << " " << type << "\n";
+    }
+
+    static void prometheus(const Counters& c, std::ostream& out) {
+        counter(out, "nodes_visited_total", "Tree nodes visited by the interpreter", "counter");
+        for (int n = 0; n < NODE_KINDS; n++) {
+            out << "huffle_nodes_visited_total{node=\"" << nodeNames[n] << "\"} " << c.nodes[n] << "\n";
+        }
+        counter(out, "enviroments_total", "Enviroments (scopes) created", "counter");
+        out << "huffle_enviroments_total " << c.enviroments << "\n";
+        counter(out, "lookups_total", "Variables looked up by name", "counter");
+        out << "huffle_lookups_total " << c.lookups << "\n";
+        counter(out, "lookup_depth_total", "Scopes searched by those lookups", "counter");
+        out << "huffle_lookup_depth_total " << c.lookupDepth << "\n";
+        counter(out, "calls_total", "Function calls", "counter");
+        out << "huffle_calls_total{kind=\"user\"} " << c.userCalls << "\n";
+        out << "huffle_calls_total{kind=\"native\"} " << c.nativeCalls << "\n";
+        counter(out, "errors_total", "Runtime errors thrown", "counter");
+        out << "huffle_errors_total " << c.errors << "\n";
+        counter(out, "allocated_bytes_total", "Bytes allocated on interpreter heaps", "counter");
+        out << "huffle_allocated_bytes_total " << c.bytes << "\n";
+        counter(out, "phase_seconds", "Time spent in each phase", "gauge");
+        out << "huffle_phase_seconds{phase=\"scan\"} " << c.scanNs / 1e9 << "\n";
+        out << "huffle_phase_seconds{phase=\"parse\"} " << c.parseNs / 1e9 << "\n";
+        out << "huffle_phase_seconds{phase=\"run\"} " << c.runNs / 1e9 << "\n";
+    }
+
+    void write(const Counters& c, Format format, std::ostream& out) {
+        if (format == JSON) {
+            json(c, out);
+        } else if (format == PROMETHEUS) {
+            prometheus(c, out);
+        } else {
+            text(c, out);
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <ostream>
+
+//Runtime statistics - built in with the HUFFLE_STATS cmake option and reported by huffle --stats
+//Each thread counts into its own Counters (so a count is a plain increment) and they are summed
+//when reported. In a build without HUFFLE_STATS every HUFF_COUNT compiles to nothing.
+namespace huff::stats {
+    #ifdef HUFFLE_STATS
+    constexpr bool enabled = true;
+    #else
+    constexpr bool enabled = false;
+    #endif
+
+    //Tree nodes the interpreter visits
+    enum Node {
+        N_PRINT, N_VAR, N_BLOCK, N_CONDITIONAL, N_WHILE, N_FUNCTION, N_IMPORT, N_CLASS, N_EXPRESSION,
+        N_RETURN, N_LITERAL, N_GROUPING, N_UNARY, N_CALL, N_BINARY, N_NUM_BINARY, N_NUM_UNARY, N_GET,
+        N_SET, N_THIS, N_DICT, N_ASSIGNMENT, N_VARIABLE, NODE_KINDS
+    };
+
+    inline const char* nodeNames[NODE_KINDS] = {
+        "Print", "Var", "Block", "Conditional", "CWhile", "Func", "Import", "Class", "Expression",
+        "Return", "Literal", "Grouping", "Unary", "Call", "Binary", "NumBinary", "NumUnary", "Get",
+        "Set", "This", "DictLiteral", "Assignment", "Variable"
+    };
+
+    struct Counters {
+        uint64_t nodes[NODE_KINDS];
+        uint64_t enviroments;
+        //Enviroment::pull calls, and the scopes they searched between them
+        uint64_t lookups;
+        uint64_t lookupDepth;
+        uint64_t nativeCalls;
+        uint64_t userCalls;
+        //Runtime errors thrown (including ones a task or module reports later)
+        uint64_t errors;
+        //Heap objects, plus growth charged to them (dictionary tables, instance fields, memo caches)
+        uint64_t bytes;
+        uint64_t scanNs;
+        uint64_t parseNs;
+        uint64_t runNs;
+
+        void add(const Counters& other) {
+            for (int n = 0; n < NODE_KINDS; n++) {
+                nodes[n] += other.nodes[n];
+            }
+            enviroments += other.enviroments;
+            lookups += other.lookups;
+            lookupDepth += other.lookupDepth;
+            nativeCalls += other.nativeCalls;
+            userCalls += other.userCalls;
+            errors += other.errors;
+            bytes += other.bytes;
+            scanNs += other.scanNs;
+            parseNs += other.parseNs;
+            runNs += other.runNs;
+        }
+    };
+
+    #ifdef HUFFLE_STATS
+    //Zero initialised, so using it needs no thread_local guard
+    inline thread_local Counters local = {};
+
+    //Adds the time it lives to one of local's timers
+    class Timer {
+        uint64_t Counters::* field;
+        std::chrono::steady_clock::time_point start;
+
+        public:
+        Timer(uint64_t Counters::* field) : field(field), start(std::chrono::steady_clock::now()) {}
+
+        ~Timer() {
+            local.*field += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+    #endif
+
+    //Includes the calling thread's counters in the totals - called as each thread that runs
+    //huffle code starts (the main thread, pool workers & check workers)
+    void attach();
+
+    //Every attached thread's counters (and those of threads that have exited), summed
+    Counters total();
+
+    enum Format { TEXT, JSON, PROMETHEUS };
+
+    //Format to write to path in - json for *.json, otherwise prometheus text
+    Format formatFor(const std::string& path);
+    void write(const Counters& c, Format format, std::ostream& out);
+}
+
+#ifdef HUFFLE_STATS
+#define HUFF_COUNT(field) (huff::stats::local.field++)
+#define HUFF_COUNT_BY(field, n) (huff::stats::local.field += (n))
+#define HUFF_COUNT_NODE(kind) (huff::stats::local.nodes[huff::stats::kind]++)
+#define HUFF_TIMER(field) huff::stats::Timer field##Timer(&huff::stats::Counters::field)
+#else
+#define HUFF_COUNT(field) ((void)0)
+#define HUFF_COUNT_BY(field, n) ((void)0)
+#define HUFF_COUNT_NODE(kind) ((void)0)
+#define HUFF_TIMER(field) ((void)0)
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include "hcall.hpp"
+#include "dict.hpp"
+#include "hstring.hpp"
+#include "strsearch.hpp"
+
+namespace huff {
+    inline const HString& toHString(const std::any& arg, std::string native) {
+        const HString* str = std::any_cast<HString>(&arg);
+        if (str == nullptr) {
+            throw new RuntimeError("Can't use " + native + "() on non-string", 0);
+        }
+        return *str;
+    }
+}
+
+//Position of the first occurrence of sub, or -1
+class indexOf : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        size_t at = huff::search::find(huff::toHString(args[0], "indexOf").view(), huff::toHString(args[1], "indexOf").view());
+        return at == huff::search::npos ? (HInt)-1 : (HInt)at;
+    }
+};
+
+//Number of non-overlapping occurrences of sub
+class count : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        return (HInt)huff::search::count(huff::toHString(args[0], "count").view(), huff::toHString(args[1], "count").view());
+    }
+};
+
+//Every occurrence of one string replaced with another
+class replace : public HCallable {
+    public:
+    int numArgs=3;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        const HString& str = huff::toHString(args[0], "replace");
+        std::string_view hay = str.view();
+        std::string_view from = huff::toHString(args[1], "replace").view();
+        std::string_view to = huff::toHString(args[2], "replace").view();
+        if (from.empty()) {
+            return str;
+        }
+
+        size_t at = huff::search::find(hay, from);
+        if (at == huff::search::npos) {
+            return str;
+        }
+
+        std::string result;
+        result.reserve(hay.size());
+        size_t last = 0;
+        while (at != huff::search::npos) {
+            result.append(hay.substr(last, at - last));
+            result.append(to);
+            last = at + from.size();
+            at = huff::search::find(hay, from, last);
+        }
+        result.append(hay.substr(last));
+        return HString(std::move(result));
+    }
+};
+
+//Pieces between separators, as a dictionary indexed from 0
+//Pieces share the original string's buffer rather than copying it
+class split : public HCallable {
+    public:
+    int numArgs=2;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        const HString& str = huff::toHString(args[0], "split");
+        std::string_view hay = str.view();
+        std::string_view sep = huff::toHString(args[1], "split").view();
+        if (sep.empty()) {
+            throw new RuntimeError("split() separator can't be empty", 0);
+        }
+
+        Dict* parts = i->heap.make<Dict>();
+        HInt index = 0;
+        size_t last = 0;
+        size_t at = huff::search::find(hay, sep);
+        while (at != huff::search::npos) {
+            parts->set(DictKey(index++), str.slice(last, at - last));
+            last = at + sep.size();
+            at = huff::search::find(hay, sep, last);
+        }
+        parts->set(DictKey(index), str.slice(last, hay.size() - last));
+        return parts;
+    }
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HUFF_X86 1
+#endif
+
+//Byte & substring search kernels used by the string natives
+//SSE2 and AVX2 versions are picked at runtime from what the cpu supports, with a
+//portable scalar version for everything else
+
+namespace huff {
+    namespace search {
+        typedef size_t (*FindFn)(const char* hay, size_t n, const char* needle, size_t m);
+
+        const size_t npos = std::string_view::npos;
+
+        inline size_t findScalar(const char* hay, size_t n, const char* needle, size_t m) {
+            return std::string_view(hay, n).find(std::string_view(needle, m));
+        }
+
+#ifdef HUFF_X86
+        //Compares the needle's first and last bytes against 16 haystack positions
+        //at once, then confirms the (rare) candidates with memcmp
+        inline size_t findSSE2(const char* hay, size_t n, const char* needle, size_t m) {
+            if (m == 0) return 0;
+            if (m > n) return npos;
+            if (m == 1) {
+                const void* at = memchr(hay, needle[0], n);
+                return at == nullptr ? npos : (const char*)at - hay;
+            }
+
+            const __m128i first = _mm_set1_epi8(needle[0]);
+            const __m128i last = _mm_set1_epi8(needle[m - 1]);
+            size_t i = 0;
+            for (; i + m - 1 + 16 <= n; i += 16) {
+                __m128i blockFirst = _mm_loadu_si128((const __m128i*)(hay + i));
+                __m128i blockLast = _mm_loadu_si128((const __m128i*)(hay + i + m - 1));
+                unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+                while (mask != 0) {
+                    unsigned bit = __builtin_ctz(mask);
+                    if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0) {
+                        return i + bit;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+
+            size_t rest = findScalar(hay + i, n - i, needle, m);
+            return rest == npos ? npos : i + rest;
+        }
+
+        __attribute__((target("avx2")))
+        inline size_t findAVX2(const char* hay, size_t n, const char* needle, size_t m) {
+            if (m == 0) return 0;
+            if (m > n) return npos;
+
+            const __m256i first = _mm256_set1_epi8(needle[0]);
+            const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+            size_t i = 0;
+            for (; i + m - 1 + 32 <= n; i += 32) {
+                __m256i blockFirst = _mm256_loadu_si256((const __m256i*)(hay + i));
+                __m256i blockLast = _mm256_loadu_si256((const __m256i*)(hay + i + m - 1));
+                unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast)));
+                while (mask != 0) {
+                    unsigned bit = __builtin_ctz(mask);
+                    if (m <= 2 || memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0) {
+                        return i + bit;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+
+            size_t rest = findScalar(hay + i, n - i, needle, m);
+            return rest == npos ? npos : i + rest;
+        }
+#endif
+
+        inline FindFn selectFind() {
+#ifdef HUFF_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return findAVX2;
+            if (__builtin_cpu_supports("sse2")) return findSSE2;
+#endif
+            return findScalar;
+        }
+
+        //Chosen once, on first use
+        inline size_t find(std::string_view hay, std::string_view needle, size_t from = 0) {
+            static const FindFn impl = selectFind();
+            if (from > hay.size()) return npos;
+            size_t at = impl(hay.data() + from, hay.size() - from, needle.data(), needle.size());
+            return at == npos ? npos : from + at;
+        }
+
+        //Non-overlapping occurrences
+        inline size_t count(std::string_view hay, std::string_view needle) {
+            if (needle.empty()) return 0;
+
+            size_t total = 0;
+            size_t at = find(hay, needle);
+            while (at != npos) {
+                total++;
+                at = find(hay, needle, at + needle.size());
+            }
+            return total;
+        }
+    }
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <functional>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Open addressing hash table in the style of a swiss table
+//Keys & values live in one flat slot array, and a parallel array of control bytes
+//(empty, deleted or 7 bits of the hash) is probed 16 slots at a time, so most
+//misses never touch a slot and most hits compare a single key
+template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class SwissMap {
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+    static constexpr size_t GROUP = 16;
+
+    public:
+    struct Slot {
+        K key;
+        V value;
+    };
+
+    private:
+    int8_t* ctrl = nullptr;
+    Slot* slots = nullptr;
+    size_t capacity = 0;
+    size_t count = 0;
+    size_t tombstones = 0;
+    Hash hasher;
+    Eq equal;
+
+    static uint64_t mix(uint64_t h) {
+        //Spread the hash so the low 7 bits (used as the tag) and the high bits (used for position) are independent
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static int8_t tag(uint64_t h) {
+        return (int8_t)(h & 0x7F);
+    }
+
+    //Bitmask of positions in the group starting at pos whose control byte equals b
+    uint32_t matchByte(size_t pos, int8_t b) const {
+#if defined(__SSE2__)
+        __m128i group = _mm_loadu_si128((const __m128i*)(ctrl + pos));
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(b)));
+#else
+        uint32_t mask = 0;
+        for (size_t x = 0; x < GROUP; x++) {
+            if (ctrl[pos + x] == b) mask |= 1u << x;
+        }
+        return mask;
+#endif
+    }
+
+    //Bitmask of empty or deleted positions (control byte has its high bit set)
+    uint32_t matchFree(size_t pos) const {
+#if defined(__SSE2__)
+        __m128i group = _mm_loadu_si128((const __m128i*)(ctrl + pos));
+        return (uint32_t)_mm_movemask_epi8(group);
+#else
+        uint32_t mask = 0;
+        for (size_t x = 0; x < GROUP; x++) {
+            if (ctrl[pos + x] < 0) mask |= 1u << x;
+        }
+        return mask;
+#endif
+    }
+
+    void setCtrl(size_t i, int8_t b) {
+        ctrl[i] = b;
+        //The first group is mirrored past the end so groups can be loaded without wrapping
+        if (i < GROUP) {
+            ctrl[capacity + i] = b;
+        }
+    }
+
+    void allocate(size_t cap) {
+        capacity = cap;
+        ctrl = new int8_t[cap + GROUP];
+        memset(ctrl, EMPTY, cap + GROUP);
+        slots = (Slot*)::operator new(sizeof(Slot) * cap);
+    }
+
+    void release() {
+        if (ctrl == nullptr) return;
+        for (size_t i = 0; i < capacity; i++) {
+            if (ctrl[i] >= 0) {
+                slots[i].~Slot();
+            }
+        }
+        delete[] ctrl;
+        ::operator delete(slots);
+        ctrl = nullptr;
+        slots = nullptr;
+    }
+
+    //Position of key, or -1
+    long find(const K& key, uint64_t h) const {
+        if (capacity == 0) return -1;
+
+        size_t mask = capacity - 1;
+        size_t pos = (h >> 7) & mask;
+        for (size_t step = GROUP;; step += GROUP) {
+            uint32_t candidates = matchByte(pos, tag(h));
+            while (candidates != 0) {
+                size_t i = (pos + __builtin_ctz(candidates)) & mask;
+                if (equal(slots[i].key, key)) {
+                    return (long)i;
+                }
+                candidates &= candidates - 1;
+            }
+            if (matchByte(pos, EMPTY) != 0) {
+                return -1;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    size_t findFree(uint64_t h) const {
+        size_t mask = capacity - 1;
+        size_t pos = (h >> 7) & mask;
+        for (size_t step = GROUP;; step += GROUP) {
+            uint32_t free = matchFree(pos);
+            if (free != 0) {
+                return (pos + __builtin_ctz(free)) & mask;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    void rehash(size_t cap) {
+        int8_t* oldCtrl = ctrl;
+        Slot* oldSlots = slots;
+        size_t oldCapacity = capacity;
+
+        allocate(cap);
+        tombstones = 0;
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (oldCtrl[i] >= 0) {
+                uint64_t h = mix(hasher(oldSlots[i].key));
+                size_t to = findFree(h);
+                setCtrl(to, tag(h));
+                new (&slots[to]) Slot{std::move(oldSlots[i].key), std::move(oldSlots[i].value)};
+                oldSlots[i].~Slot();
+            }
+        }
+
+        delete[] oldCtrl;
+        ::operator delete(oldSlots);
+    }
+
+    public:
+    SwissMap() = default;
+
+    SwissMap(const SwissMap&) = delete;
+    SwissMap& operator=(const SwissMap&) = delete;
+
+    ~SwissMap() {
+        release();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    V* get(const K& key) {
+        long i = find(key, mix(hasher(key)));
+        return i < 0 ? nullptr : &slots[i].value;
+    }
+
+    bool has(const K& key) const {
+        return find(key, mix(hasher(key))) >= 0;
+    }
+
+    //Makes room for n entries in all, so adding up to that many never rehashes
+    void reserve(size_t n) {
+        size_t cap = capacity == 0 ? GROUP : capacity;
+        while (n * 8 > cap * 7) cap *= 2;
+        if (cap != capacity) rehash(cap);
+    }
+
+    //Inserts or overwrites
+    void set(const K& key, V value) {
+        uint64_t h = mix(hasher(key));
+        long i = find(key, h);
+        if (i >= 0) {
+            slots[i].value = std::move(value);
+            return;
+        }
+
+        //Keep the load (including tombstones) under 7/8
+        if ((count + tombstones + 1) * 8 > capacity * 7) {
+            size_t cap = capacity == 0 ? GROUP : capacity;
+            while ((count + 1) * 8 > cap * 7 / 2) cap *= 2;
+            rehash(cap);
+        }
+
+        size_t to = findFree(h);
+        if (ctrl[to] == DELETED) tombstones--;
+        setCtrl(to, tag(h));
+        new (&slots[to]) Slot{key, std::move(value)};
+        count++;
+    }
+
+    bool erase(const K& key) {
+        long i = find(key, mix(hasher(key)));
+        if (i < 0) return false;
+
+        slots[i].~Slot();
+        setCtrl(i, DELETED);
+        count--;
+        tombstones++;
+        return true;
+    }
+
+    //Slot iteration - positions 0..slotCount(), skipping those where full() is false
+    size_t slotCount() const {
+        return capacity;
+    }
+
+    bool full(size_t i) const {
+        return ctrl[i] >= 0;
+    }
+
+    Slot& slot(size_t i) {
+        return slots[i];
+    }
+
+    template<typename F> void each(F fn) {
+        for (size_t i = 0; i < capacity; i++) {
+            if (ctrl[i] >= 0) {
+                fn(slots[i].key, slots[i].value);
+            }
+        }
+    }
+};
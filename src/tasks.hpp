@@ -0,0 +1,496 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include "hcall.hpp"
+#include "object.hpp"
+#include "dict.hpp"
+#include "modules.hpp"
+
+//Work stealing thread pool
+//Each worker owns a deque - it pushes & pops its own jobs at the back (newest first, so
+//nested spawns run while their data is still in cache) and idle workers steal from the
+//front of the others. Jobs submitted from outside the pool go in a shared queue.
+class TaskPool {
+    using Job = std::function<void()>;
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    //One per worker, then the shared queue last
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<long> pending{0};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping = false;
+    //Signalled after every job, for threads waiting in helpUntil()
+    std::mutex finishLock;
+    std::condition_variable finished;
+
+    static inline thread_local TaskPool* owner = nullptr;
+    static inline thread_local size_t self = 0;
+
+    bool pop(size_t q, Job& job, bool newest) {
+        Queue& queue = *queues[q];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) return false;
+
+        if (newest) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        return true;
+    }
+
+    void work(size_t index) {
+        owner = this;
+        self = index;
+        huff::stats::attach();
+        while (true) {
+            if (runOne()) continue;
+
+            std::unique_lock<std::mutex> sleep(sleepLock);
+            wake.wait(sleep, [&] { return stopping || pending > 0; });
+            if (stopping && pending == 0) return;
+        }
+    }
+
+    public:
+    TaskPool(unsigned workers) {
+        workers = std::max(1u, workers);
+        for (unsigned w = 0; w <= workers; w++) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned w = 0; w < workers; w++) {
+            threads.emplace_back(&TaskPool::work, this, w);
+        }
+    }
+
+    //Finishes every queued job before returning
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    void submit(Job job) {
+        size_t q = owner == this ? self : queues.size() - 1;
+        pending++;
+        {
+            std::lock_guard<std::mutex> guard(queues[q]->lock);
+            queues[q]->jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+        }
+        wake.notify_one();
+    }
+
+    //Runs one queued job on the calling thread - own jobs first, then stolen ones
+    //Returns false if there was nothing to run
+    bool runOne() {
+        Job job;
+        bool mine = owner == this;
+        size_t start = mine ? self : queues.size() - 1;
+        bool found = mine && pop(self, job, true);
+        for (size_t k = 1; !found && k <= queues.size(); k++) {
+            found = pop((start + k) % queues.size(), job, false);
+        }
+        if (!found) return false;
+
+        pending--;
+        job();
+        {
+            std::lock_guard<std::mutex> guard(finishLock);
+        }
+        finished.notify_all();
+        return true;
+    }
+
+    //Runs other jobs until done() holds, so waiting inside a job never starves the pool
+    template<typename F> void helpUntil(F done) {
+        while (!done()) {
+            if (!runOne()) {
+                std::unique_lock<std::mutex> wait(finishLock);
+                finished.wait_for(wait, std::chrono::milliseconds(1), [&] { return done() || pending > 0; });
+            }
+        }
+    }
+};
+
+namespace huff {
+    inline std::mutex& poolLock() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    inline unsigned& poolThreads() {
+        static unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        return threads;
+    }
+
+    inline std::unique_ptr<TaskPool>& poolInstance() {
+        static std::unique_ptr<TaskPool> pool;
+        return pool;
+    }
+
+    //The process wide pool, started on first use
+    inline TaskPool& pool() {
+        std::lock_guard<std::mutex> guard(poolLock());
+        std::unique_ptr<TaskPool>& pool = poolInstance();
+        if (pool == nullptr) {
+            pool = std::make_unique<TaskPool>(poolThreads());
+        }
+        return *pool;
+    }
+
+    //Sets the worker count - an existing pool is drained & restarted, so only call this while idle
+    inline void setPoolThreads(unsigned threads) {
+        std::lock_guard<std::mutex> guard(poolLock());
+        poolThreads() = std::max(1u, threads);
+        poolInstance().reset();
+    }
+}
+
+//Copies values from one interpreter into another, so a task shares nothing mutable with its spawner
+//Numbers, bools, nul & strings are copied (string buffers are frozen first); functions & classes
+//are rebuilt in the target heap over copies of the globals & upvalues they close over. Dictionaries,
+//instances, files & futures are mutable and aren't copied - unless mutables is set, when dictionaries
+//& instances are copied deeply too (files & futures never are).
+class Transplant {
+    Interpreter* from;
+    Interpreter* to;
+    //Where the source's globals are copied
+    Enviroment* globals;
+    std::map<GcObject*, GcObject*> copied;
+    //The source's global name for each of its natives - filled on the first native copied
+    std::map<HCallable*, std::string> nativeNames;
+    //Everything made in the target stays rooted until the copy is finished
+    RootScope scope;
+
+    template<typename T> T* keep(GcObject* source, T* copy) {
+        copied[source] = copy;
+        to->heap.pushRoot(copy);
+        return copy;
+    }
+
+    UDCallable* function(UDCallable* f) {
+        auto found = copied.find(f);
+        if (found != copied.end()) return (UDCallable*)found->second;
+
+        UDCallable* copy = keep(f, to->heap.make<UDCallable>(f->declaration, nullptr));
+        copy->globals = env(f->globals);
+        for (size_t u = 0; u < f->upvalues.size(); u++) {
+            copy->upvalues.push_back(upvalue(f->upvalues[u], f->declaration, u));
+        }
+        return copy;
+    }
+
+    //Closed copy of a captured variable - shared by every copied function that shares the original
+    Upvalue* upvalue(Upvalue* up, Func* owner, size_t index) {
+        auto found = copied.find(up);
+        if (found != copied.end()) return (Upvalue*)found->second;
+
+        Upvalue* copy = keep(up, to->heap.make<Upvalue>(std::any()));
+        if (!value(*up->location, copy->closed)) {
+            throw new RuntimeError("spawn() function " + owner->name.lexeme + " captures " + owner->captures[index].name + ", which is mutable", 0);
+        }
+        return copy;
+    }
+
+    Dict* dict(Dict* d) {
+        auto found = copied.find(d);
+        if (found != copied.end()) return (Dict*)found->second;
+
+        Dict* copy = keep(d, to->heap.make<Dict>());
+        copy->reserve(d->table.size());
+        bool whole = true;
+        d->table.each([&](const DictKey& key, std::any& v) {
+            std::any k, shared;
+            whole = whole && value(key.toValue(), k) && value(v, shared);
+            if (whole) copy->set(huff::toKey(k, 0), shared);
+        });
+        //Holds a file or future - copies found later see it's not copied
+        if (!whole) copied[d] = nullptr;
+        return whole ? copy : nullptr;
+    }
+
+    Instance* instance(Instance* in) {
+        auto found = copied.find(in);
+        if (found != copied.end()) return (Instance*)found->second;
+
+        HClass* c = klass(in->klass);
+        Instance* copy = keep(in, to->heap.make<Instance>(c, c->root, in->slots.size()));
+        for (size_t s = 0; s < in->slots.size(); s++) {
+            std::any shared;
+            if (!value(in->slots[s], shared)) {
+                copied[in] = nullptr;
+                return nullptr;
+            }
+            copy->shape = copy->shape->with(in->shape->fields[s]);
+            copy->slots.push_back(shared);
+        }
+        to->heap.charge(copy, copy->slots.size() * sizeof(std::any));
+        return copy;
+    }
+
+    HClass* klass(HClass* c) {
+        auto found = copied.find(c);
+        if (found != copied.end()) return (HClass*)found->second;
+
+        HClass* copy = keep(c, to->heap.make<HClass>(c->declaration));
+        copy->expectedSlots = c->expectedSlots.load();
+        for (auto& m : c->methods) {
+            copy->methods[m.first] = function(m.second);
+        }
+        return copy;
+    }
+
+    //Natives are stateless, so a native value maps to the target's native of the same name
+    bool native(HCallable* n, std::any& out) {
+        if (nativeNames.empty()) {
+            from->global->each([&](const std::string& key, std::any& val) {
+                if (val.type() == typeid(HCallable*)) nativeNames[std::any_cast<HCallable*>(val)] = key;
+            });
+        }
+        auto name = nativeNames.find(n);
+        std::any* found = name == nativeNames.end() ? nullptr : to->global->find(name->second);
+        if (found == nullptr) return false;
+        out = *found;
+        return true;
+    }
+
+    public:
+    //Copy dictionaries & instances too - for a module's globals, which its functions may change, so
+    //each interpreter using the module gets its own
+    bool mutables = false;
+
+    //The source's globals map onto the target's own, unless given a scope to copy them into
+    Transplant(Interpreter* from, Interpreter* to, Enviroment* globals = nullptr) : scope(to->heap) {
+        this->from = from;
+        this->to = to;
+        this->globals = globals != nullptr ? globals : to->global;
+    }
+
+    //Copy of an immutable value - false (and out untouched) if val is mutable
+    bool value(const std::any& val, std::any& out) {
+        if (!val.has_value() || huff::isNumber(val) || val.type() == typeid(bool)
+                || val.type() == typeid(long) || val.type() == typeid(int)) {
+            out = val;
+            return true;
+        }
+        if (val.type() == typeid(HString)) {
+            std::any_cast<const HString&>(val).freeze();
+            out = val;
+            return true;
+        }
+        if (Module* const* m = std::any_cast<Module*>(&val)) {
+            //Loads separately in the target, the first time it's used there
+            out = keep(*m, to->heap.make<Module>((*m)->file, (*m)->name));
+            return true;
+        }
+        if (Dict* const* d = std::any_cast<Dict*>(&val)) {
+            Dict* copy = mutables ? dict(*d) : nullptr;
+            if (copy != nullptr) out = copy;
+            return copy != nullptr;
+        }
+        if (Instance* const* in = std::any_cast<Instance*>(&val)) {
+            Instance* copy = mutables ? instance(*in) : nullptr;
+            if (copy != nullptr) out = copy;
+            return copy != nullptr;
+        }
+        if (val.type() != typeid(HCallable*)) {
+            return false;
+        }
+
+        HCallable* callable = std::any_cast<HCallable*>(val);
+        if (UDCallable* f = dynamic_cast<UDCallable*>(callable)) {
+            out = (HCallable*)function(f);
+            return true;
+        }
+        if (HClass* c = dynamic_cast<HClass*>(callable)) {
+            out = (HCallable*)klass(c);
+            return true;
+        }
+        if (BoundMethod* b = dynamic_cast<BoundMethod*>(callable)) {
+            Instance* self = mutables ? instance(b->self) : nullptr;
+            if (self == nullptr) return false;
+            out = (HCallable*)keep(b, to->heap.make<BoundMethod>(function(b->method), self));
+            return true;
+        }
+        return native(callable, out);
+    }
+
+    //Copy of a scope chain holding the immutable values in each scope
+    //The source's global scope maps onto globals, whose natives are kept
+    Enviroment* env(Enviroment* e) {
+        if (e == nullptr) return nullptr;
+        auto found = copied.find(e);
+        if (found != copied.end()) return (Enviroment*)found->second;
+
+        Enviroment* copy;
+        if (e == from->global) {
+            copy = keep(e, globals);
+        } else {
+            copy = keep(e, to->heap.make<Enviroment>(e->isFunc, nullptr));
+            copy->enclosing = env(e->enclosing);
+        }
+
+        e->each([&](const std::string& name, std::any& val) {
+            if (e == from->global && copy->find(name) != nullptr) return;
+            std::any shared;
+            if (value(val, shared)) {
+                copy->define(name, shared);
+            }
+        });
+        return copy;
+    }
+};
+
+//One spawned call, run on an interpreter of its own
+struct Task {
+    std::unique_ptr<Interpreter> interp;
+    std::any fn;
+    std::vector<std::any> args;
+
+    std::atomic<bool> done{false};
+    std::any result;
+    Err* error = nullptr;
+
+    ~Task() {
+        delete error;
+    }
+
+    void run() {
+        try {
+            RootScope scope(interp->heap);
+            interp->heap.pushRoot(&fn);
+            for (std::any& a : args) {
+                interp->heap.pushRoot(&a);
+            }
+
+            std::any val = std::any_cast<HCallable*>(fn)->call(interp.get(), args);
+            if (!share(val)) {
+                throw new RuntimeError("Spawned function returned a mutable value (only numbers, strings, bools & nul can be returned)", 0);
+            }
+            result = val;
+        } catch (Err* e) {
+            error = e;
+        } catch (...) {
+            error = new RuntimeError("Spawned task failed", 0);
+        }
+
+        //Nothing in the task's heap outlives it
+        interp.reset();
+        done.store(true, std::memory_order_release);
+    }
+
+    //Whether a result can be handed back to the spawner as is
+    static bool share(const std::any& val) {
+        if (val.type() == typeid(HString)) {
+            std::any_cast<const HString&>(val).freeze();
+            return true;
+        }
+        return !val.has_value() || huff::isNumber(val) || val.type() == typeid(bool)
+            || val.type() == typeid(long) || val.type() == typeid(int);
+    }
+};
+
+//Handle returned by spawn()
+class Future : public GcObject {
+    public:
+    std::shared_ptr<Task> task;
+
+    Future(std::shared_ptr<Task> task) {
+        this->task = std::move(task);
+    }
+};
+
+namespace huff {
+    inline Future* toFuture(const std::any& arg, std::string native) {
+        if (arg.type() != typeid(Future*)) {
+            throw new RuntimeError("Can't use " + native + "() on non-future", 0);
+        }
+        return std::any_cast<Future*>(arg);
+    }
+}
+
+//spawn( fn, args... ) - runs fn(args...) on the task pool and returns a future for its result
+//fn runs on a copy of the immutable values it can see, and args must be immutable too
+class spawnTask : public HCallable {
+    public:
+    int numArgs=-1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        if (args.empty() || args[0].type() != typeid(HCallable*)) {
+            throw new RuntimeError("spawn() expects a function to run", 0);
+        }
+
+        auto task = std::make_shared<Task>();
+        task->interp = std::make_unique<Interpreter>();
+        task->interp->heap.setThreshold(i->heap.threshold);
+        task->interp->heap.stress = i->heap.stress;
+        task->interp->heap.setLimit(i->heap.limit);
+        task->interp->budget.inherit(i->budget);
+
+        {
+            Transplant copy(i, task->interp.get());
+            if (!copy.value(args[0], task->fn)) {
+                throw new RuntimeError("spawn() can't run a bound method (its instance is mutable)", 0);
+            }
+            for (size_t a = 1; a < args.size(); a++) {
+                std::any shared;
+                if (!copy.value(args[a], shared)) {
+                    throw new RuntimeError("spawn() arguments must be immutable (numbers, strings, bools, nul or functions)", 0);
+                }
+                task->args.push_back(shared);
+            }
+        }
+
+        huff::pool().submit([task] { task->run(); });
+        return i->heap.make<Future>(task);
+    }
+};
+
+//await( future ) - result of the spawned call, rethrowing its error
+//The waiting thread runs other queued tasks meanwhile
+class awaitTask : public HCallable {
+    public:
+    int numArgs=1;
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        std::shared_ptr<Task> task = huff::toFuture(args[0], "await")->task;
+        if (!task->done.load(std::memory_order_acquire)) {
+            huff::pool().helpUntil([&] { return task->done.load(std::memory_order_acquire); });
+        }
+
+        if (task->error != nullptr) {
+            Err* error = task->error;
+            task->error = new RuntimeError("Awaited task already failed", 0);
+            throw error;
+        }
+        return task->result;
+    }
+};
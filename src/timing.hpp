@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "hcall.hpp"
+#include "dict.hpp"
+
+//Timing natives - clock() for measuring by hand, and bench() for timing a function's calls
+namespace huff {
+    //Nanoseconds on the monotonic clock (from an arbitrary start, so only differences mean anything)
+    inline HInt nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline double median(std::vector<HInt>& samples) {
+        size_t mid = samples.size() / 2;
+        std::nth_element(samples.begin(), samples.begin() + mid, samples.end());
+        double upper = samples[mid];
+        if (samples.size() % 2 == 1) return upper;
+        return (*std::max_element(samples.begin(), samples.begin() + mid) + upper) / 2;
+    }
+
+    //Times each of samples.size() calls of fn, with no arguments
+    inline void timeCalls(Interpreter* i, HCallable* fn, std::vector<HInt>& samples) {
+        for (HInt& sample : samples) {
+            HInt start = nowNs();
+            fn->call(i, std::vector<std::any>());
+            sample = nowNs() - start;
+        }
+    }
+}
+
+//clock() - monotonic time in nanoseconds, as an integer
+class clockNs : public HCallable {
+    public:
+    int numArgs=0;
+
+    std::any call(Interpreter*, std::vector<std::any>) {
+        return huff::nowNs();
+    }
+};
+
+//bench( fn, iterations ) - calls fn() iterations times after a warm-up, and returns a dictionary of
+//the per-call "mean", "median", "stddev" & "min" in nanoseconds. The time the harness itself takes
+//per call (reading the clock & calling a function of the same kind with an empty body) is measured
+//after the warm-up and taken off every sample - it's returned as "overhead".
+class benchCalls : public HCallable {
+    public:
+    int numArgs=2;
+    //Calls timed to find the overhead, whatever the iteration count
+    static const size_t CALIBRATION = 1000;
+
+    //Does nothing - stands in for a native fn
+    struct Empty : public HCallable {
+        int numArgs=0;
+
+        std::any call(Interpreter*, std::vector<std::any>) {
+            return NULL;
+        }
+    };
+
+    //Called through the same path as fn, with nothing to do
+    static HCallable* empty(Interpreter* i, HCallable* fn) {
+        if (UDCallable* f = dynamic_cast<UDCallable*>(fn)) {
+            static Func decl(Token(IDENTIFIER, "empty", NULL, 0), {}, {});
+            return i->heap.make<UDCallable>(&decl, f->globals);
+        }
+        return i->heap.make<Empty>();
+    }
+
+    std::any call(Interpreter* i, std::vector<std::any> args) {
+        if (args.size() != 2) {
+            throw new RuntimeError("bench() expects a function and a number of iterations", 0);
+        }
+        HCallable* fn;
+        try {
+            fn = std::any_cast<HCallable*>(args[0]);
+        } catch (std::bad_any_cast& e) {
+            throw new RuntimeError("bench() expects a function as its first argument", 0);
+        }
+        HInt iterations;
+        if (args[1].type() == typeid(HInt)) {
+            iterations = std::any_cast<HInt>(args[1]);
+        } else if (args[1].type() == typeid(double) && std::floor(std::any_cast<double>(args[1])) == std::any_cast<double>(args[1])) {
+            iterations = (HInt)std::any_cast<double>(args[1]);
+        } else {
+            throw new RuntimeError("bench() expects a whole number of iterations", 0);
+        }
+        if (iterations < 1) {
+            throw new RuntimeError("bench() needs at least 1 iteration", 0);
+        }
+
+        //Warm-up - a tenth as many calls again, for caches, the allocator & memo tables
+        std::vector<HInt> samples(iterations / 10 + 1);
+        huff::timeCalls(i, fn, samples);
+
+        //Overhead is the median of the empty calls, so one slow clock read doesn't skew it
+        RootScope scope(i->heap);
+        HCallable* calibrate = empty(i, fn);
+        i->heap.pushRoot(calibrate);
+        samples.resize(CALIBRATION);
+        huff::timeCalls(i, calibrate, samples);
+        double overhead = huff::median(samples);
+
+        samples.resize(iterations);
+        huff::timeCalls(i, fn, samples);
+        double sum = 0;
+        for (HInt& sample : samples) {
+            sample = std::max<HInt>(sample - (HInt)std::llround(overhead), 0);
+            sum += sample;
+        }
+        double mean = sum / iterations;
+        double squares = 0;
+        for (HInt sample : samples) {
+            squares += (sample - mean) * (sample - mean);
+        }
+        double stddev = iterations > 1 ? std::sqrt(squares / (iterations - 1)) : 0;
+        double min = *std::min_element(samples.begin(), samples.end());
+
+        Dict* result = i->heap.make<Dict>();
+        result->set(DictKey(std::string("mean")), mean);
+        result->set(DictKey(std::string("median")), huff::median(samples));
+        result->set(DictKey(std::string("stddev")), stddev);
+        result->set(DictKey(std::string("min")), min);
+        result->set(DictKey(std::string("overhead")), overhead);
+        return result;
+    }
+};
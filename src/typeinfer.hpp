@@ -0,0 +1,522 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "astwalk.hpp"
+#include "utils.hpp"
+
+//What inference knows about a value - an integer, a double, a number of either kind, or anything
+enum InferredType {
+    T_INT, T_DOUBLE, T_NUM, T_ANY
+};
+
+//Finds every variable a function call could reassign behind the caller's back
+//Those are the names functions assign without declaring them first (so the assignment lands in an
+//enclosing scope)
+class ClobberScan : public AstWalker {
+    std::vector<std::set<std::string>> scopes;
+
+    bool declared(const std::string& name) {
+        for (auto& scope : scopes) {
+            if (scope.count(name)) return true;
+        }
+        return false;
+    }
+
+    public:
+    using AstWalker::walk;
+    std::set<std::string> clobbered;
+
+    ClobberScan(const std::vector<Stmt*>& stmts) {
+        walk(stmts);
+    }
+
+    std::any visitVarStmt(Var* s) {
+        walk(s->initialiser);
+        if (!scopes.empty()) scopes.back().insert(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitImportStmt(Import* s) {
+        if (!scopes.empty()) scopes.back().insert(s->name.lexeme);
+        return NULL;
+    }
+
+    std::any visitAssignmentExpr(Assignment* e) {
+        walk(e->expression);
+        if (!scopes.empty() && !declared(e->name.lexeme)) {
+            clobbered.insert(e->name.lexeme);
+        }
+        return NULL;
+    }
+
+    std::any visitBlockStmt(Block* s) {
+        if (scopes.empty()) return AstWalker::visitBlockStmt(s);
+        scopes.emplace_back();
+        walk(s->statements);
+        scopes.pop_back();
+        return NULL;
+    }
+
+    std::any visitFunctionStmt(Func* s) {
+        if (!scopes.empty()) scopes.back().insert(s->name.lexeme);
+
+        //A nested function only sees its own declarations - what it assigns outside them is free
+        std::vector<std::set<std::string>> outer = std::move(scopes);
+        scopes = {std::set<std::string>()};
+        for (const Token& param : s->params) {
+            scopes.back().insert(param.lexeme);
+        }
+        walk(s->body);
+        scopes = std::move(outer);
+        return NULL;
+    }
+
+    std::any visitClassStmt(Class* s) {
+        if (!scopes.empty()) scopes.back().insert(s->name.lexeme);
+        for (Func* m : s->methods) {
+            std::vector<std::set<std::string>> outer = std::move(scopes);
+            scopes = {{"this"}};
+            for (const Token& param : m->params) {
+                scopes.back().insert(param.lexeme);
+            }
+            walk(m->body);
+            scopes = std::move(outer);
+        }
+        return NULL;
+    }
+};
+
+//Types of the variables in scope at one point of a program, innermost scope last
+struct TypeState {
+    std::vector<std::map<std::string, InferredType>> scopes;
+
+    InferredType* find(const std::string& name) {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++) {
+            auto found = scope->find(name);
+            if (found != scope->end()) return &found->second;
+        }
+        return nullptr;
+    }
+
+    InferredType get(const std::string& name) {
+        InferredType* found = find(name);
+        return found == nullptr ? T_ANY : *found;
+    }
+
+    void define(const std::string& name, InferredType type) {
+        scopes.back()[name] = type;
+    }
+
+    //Assigning a variable declared outside the region (a closure or global) changes nothing known
+    void assign(const std::string& name, InferredType type) {
+        InferredType* found = find(name);
+        if (found != nullptr) *found = type;
+    }
+
+    void forget(const std::set<std::string>& names) {
+        for (auto& scope : scopes) {
+            for (auto& var : scope) {
+                if (names.count(var.first)) var.second = T_ANY;
+            }
+        }
+    }
+
+    static InferredType join(InferredType a, InferredType b) {
+        if (a == b) return a;
+        return a == T_ANY || b == T_ANY ? T_ANY : T_NUM;
+    }
+
+    //Where control flow meets - a variable only keeps a type it has on both paths
+    void join(const TypeState& other) {
+        for (size_t s = 0; s < scopes.size() && s < other.scopes.size(); s++) {
+            for (auto& var : scopes[s]) {
+                auto found = other.scopes[s].find(var.first);
+                var.second = found == other.scopes[s].end() ? T_ANY : join(var.second, found->second);
+            }
+        }
+    }
+
+    bool operator==(const TypeState& other) const {
+        return scopes == other.scopes;
+    }
+
+    //Every variable visible from here, the innermost declaration of each name winning
+    std::map<std::string, InferredType> visible() const {
+        std::map<std::string, InferredType> vars;
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++) {
+            vars.insert(scope->begin(), scope->end());
+        }
+        return vars;
+    }
+};
+
+//Part of a program inference reports on - the top level, a function body or a loop
+struct TypeRegion {
+    std::string name;
+    int line;
+    //Types at the end of the top level or a function, at the head of every iteration of a loop
+    std::map<std::string, InferredType> vars;
+    int unchecked = 0;
+    int checked = 0;
+};
+
+//Flow sensitive type inference
+//Follows each function body (and the top level) in evaluation order, tracking which variables
+//must hold integers, doubles or numbers of either kind. Branches are joined and loops iterated until the types at their head stop
+//changing, then arithmetic & comparisons whose operands are proved to be integers or doubles are
+//replaced with NumBinary / NumUnary nodes that skip the interpreter's type checks.
+//Function parameters, closures, globals seen from functions & call results are never assumed to be
+//numbers, and a call forgets whatever variables the ClobberScan says a function could reassign.
+class TypeInference : public ExprVisitor, public StmtVisitor {
+    std::set<std::string> clobbered;
+    TypeState state;
+    //Only the final pass over a loop (once its types are settled) rewrites nodes & counts them
+    bool annotate = true;
+    size_t region = 0;
+    //Set by a visit to swap the node just visited for a specialised one
+    Expr* replacement = nullptr;
+    std::set<Func*> seen;
+    std::vector<std::pair<std::string, Func*>> pending;
+
+    InferredType infer(Expr*& slot) {
+        InferredType type = std::any_cast<InferredType>(slot->accept(this));
+        if (replacement != nullptr) {
+            delete slot;
+            slot = replacement;
+            replacement = nullptr;
+        }
+        return type;
+    }
+
+    void infer(Stmt* s) {
+        if (s != nullptr) s->accept(this);
+    }
+
+    void infer(const std::vector<Stmt*>& stmts) {
+        for (Stmt* s : stmts) infer(s);
+    }
+
+    static bool arithmetic(TokenType op) {
+        switch (op) {
+            case PLUS: case MINUS: case STAR: case SLASH:
+            case LESS: case GREATER: case GR_EQUAL: case LE_EQUAL:
+            case IS_EQUAL: case ISN_EQUAL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool number(InferredType type) {
+        return type != T_ANY;
+    }
+
+    static NumKind kind(InferredType type) {
+        return type == T_INT ? K_INT : type == T_DOUBLE ? K_DOUBLE : K_EITHER;
+    }
+
+    static InferredType type(NumKind kind) {
+        return kind == K_INT ? T_INT : kind == K_DOUBLE ? T_DOUBLE : T_NUM;
+    }
+
+    //Type of a binary operation that didn't throw (see numeric.hpp for the promotion rules)
+    static InferredType result(TokenType op, InferredType left, InferredType right) {
+        switch (op) {
+            case SLASH:
+                return T_DOUBLE;
+            case PLUS:
+                //Strings can be added too
+                if (left == T_ANY && right == T_ANY) return T_ANY;
+                [[fallthrough]];
+            case MINUS:
+            case STAR:
+                if (left == T_INT && right == T_INT) return T_INT;
+                if (left == T_DOUBLE || right == T_DOUBLE) return T_DOUBLE;
+                return T_NUM;
+            default:
+                //Comparisons give bools
+                return T_ANY;
+        }
+    }
+
+    //A checked operation that didn't throw leaves its variable operand known to be a number
+    void refine(Expr* operand) {
+        if (Variable* var = dynamic_cast<Variable*>(operand)) {
+            if (state.get(var->name.lexeme) == T_ANY) state.assign(var->name.lexeme, T_NUM);
+        }
+    }
+
+    void count(bool specialised) {
+        if (!annotate) return;
+        if (specialised) {
+            regions[region].unchecked++;
+        } else {
+            regions[region].checked++;
+        }
+    }
+
+    void queue(std::string name, Func* func) {
+        if (seen.insert(func).second) {
+            pending.push_back({name, func});
+        }
+    }
+
+    void function(std::string name, Func* func) {
+        state.scopes = {std::map<std::string, InferredType>()};
+        for (const Token& param : func->params) {
+            state.define(param.lexeme, T_ANY);
+        }
+        annotate = true;
+        regions.push_back(TypeRegion{name, func->name.line, {}});
+        region = regions.size() - 1;
+
+        infer(func->body);
+        regions[region].vars = state.visible();
+    }
+
+    public:
+    std::vector<TypeRegion> regions;
+
+    TypeInference(std::vector<Stmt*>& stmts) {
+        clobbered = ClobberScan(stmts).clobbered;
+
+        state.scopes = {std::map<std::string, InferredType>()};
+        regions.push_back(TypeRegion{"script", 1, {}});
+        infer(stmts);
+        regions[0].vars = state.visible();
+
+        //Each function body is its own region, inferred once wherever it's declared
+        for (size_t f = 0; f < pending.size(); f++) {
+            function(pending[f].first, pending[f].second);
+        }
+    }
+
+    //Expressions - each returns its InferredType
+    std::any visitLiteralExpr(Literal* e) {
+        if (e->value.type() == typeid(HInt)) return T_INT;
+        return e->value.type() == typeid(double) ? T_DOUBLE : T_ANY;
+    }
+
+    std::any visitGroupingExpr(Grouping* e) {
+        return infer(e->value);
+    }
+
+    std::any visitVariableExpr(Variable* e) {
+        return state.get(e->name.lexeme);
+    }
+
+    std::any visitAssignmentExpr(Assignment* e) {
+        InferredType type = infer(e->expression);
+        state.assign(e->name.lexeme, type);
+        return type;
+    }
+
+    std::any visitUnaryExpr(Unary* e) {
+        InferredType right = infer(e->right);
+        if (e->op.type != MINUS) return T_ANY;
+
+        count(number(right));
+        if (number(right) && annotate) {
+            NumUnary* unary = new NumUnary(e->op, e->right);
+            unary->kind = kind(right);
+            replacement = unary;
+        }
+        refine(e->right);
+        return right == T_ANY ? T_NUM : right;
+    }
+
+    //The interpreter evaluates the right operand first
+    std::any visitBinaryExpr(Binary* e) {
+        InferredType right = infer(e->right);
+        InferredType left = infer(e->left);
+        TokenType op = e->op.type;
+        if (!arithmetic(op)) return T_ANY;
+
+        bool numbers = number(left) && number(right);
+        count(numbers);
+        if (numbers && annotate) {
+            NumBinary* binary = new NumBinary(e->left, e->op, e->right);
+            binary->leftKind = kind(left);
+            binary->rightKind = kind(right);
+            replacement = binary;
+        }
+
+        //Equality never throws, and + only proves anything if one side is known to be a number
+        if (op == IS_EQUAL || op == ISN_EQUAL || (op == PLUS && left == T_ANY && right == T_ANY)) {
+            return T_ANY;
+        }
+        refine(e->left);
+        //Unless evaluating the left operand could have changed it since it was read
+        if (dynamic_cast<Variable*>(e->left) || dynamic_cast<Literal*>(e->left)) {
+            refine(e->right);
+        }
+        return result(op, left, right);
+    }
+
+    std::any visitNumBinaryExpr(NumBinary* e) {
+        infer(e->right);
+        infer(e->left);
+        count(true);
+        return result(e->op.type, type(e->leftKind), type(e->rightKind));
+    }
+
+    std::any visitNumUnaryExpr(NumUnary* e) {
+        infer(e->right);
+        count(true);
+        return type(e->kind);
+    }
+
+    std::any visitCallableExpr(Call* e) {
+        infer(e->callee);
+        for (Expr*& arg : e->args) infer(arg);
+        state.forget(clobbered);
+        return T_ANY;
+    }
+
+    std::any visitGetExpr(Get* e) {
+        infer(e->object);
+        return T_ANY;
+    }
+
+    std::any visitSetExpr(Set* e) {
+        infer(e->object);
+        infer(e->value);
+        return T_ANY;
+    }
+
+    std::any visitThisExpr(This*) {
+        return T_ANY;
+    }
+
+    std::any visitDictExpr(DictLiteral* e) {
+        for (size_t x = 0; x < e->keys.size(); x++) {
+            infer(e->keys[x]);
+            infer(e->values[x]);
+        }
+        return T_ANY;
+    }
+
+    //Statements
+    std::any visitExpressionStmt(Expression* s) {
+        infer(s->expression);
+        return NULL;
+    }
+
+    std::any visitPrintStmt(Print* s) {
+        infer(s->expression);
+        return NULL;
+    }
+
+    std::any visitReturnStmt(Return* s) {
+        infer(s->returnVal);
+        return NULL;
+    }
+
+    std::any visitVarStmt(Var* s) {
+        state.define(s->name.lexeme, infer(s->initialiser));
+        return NULL;
+    }
+
+    std::any visitBlockStmt(Block* s) {
+        state.scopes.emplace_back();
+        infer(s->statements);
+        state.scopes.pop_back();
+        return NULL;
+    }
+
+    //Mirrors the interpreter - every elf is tried in turn once the first condition fails
+    std::any visitConditionalStmt(Conditional* s) {
+        infer(s->condition);
+        TypeState otherwise = state;
+        infer(s->thenBranch);
+        TypeState then = std::move(state);
+
+        state = std::move(otherwise);
+        for (Conditional* elf : s->elfs) {
+            infer(elf->condition);
+            TypeState skipped = state;
+            infer(elf->thenBranch);
+            TypeState taken = std::move(state);
+            state = std::move(skipped);
+            infer(elf->elseBranch);
+            state.join(taken);
+        }
+        infer(s->elseBranch);
+        state.join(then);
+        return NULL;
+    }
+
+    std::any visitCWhileStmt(CWhile* s) {
+        TypeState entry = state;
+        bool outer = annotate;
+        annotate = false;
+        while (true) {
+            TypeState head = state;
+            infer(s->condition);
+            infer(s->body);
+            state.join(entry);
+            state.join(head);
+            if (state == head) break;
+        }
+
+        annotate = outer;
+        if (annotate) {
+            size_t parent = region;
+            regions.push_back(TypeRegion{"loop", s->keyword.line, state.visible()});
+            region = regions.size() - 1;
+            infer(s->condition);
+            TypeState exit = state;
+            infer(s->body);
+            state = std::move(exit);
+            region = parent;
+        } else {
+            infer(s->condition);
+        }
+        return NULL;
+    }
+
+    //Declaring a function defines it in the current scope (see Interpreter::visitFunctionStmt)
+    std::any visitFunctionStmt(Func* s) {
+        state.define(s->name.lexeme, T_ANY);
+        queue("fun " + s->name.lexeme, s);
+        return NULL;
+    }
+
+    std::any visitImportStmt(Import* s) {
+        state.define(s->name.lexeme, T_ANY);
+        return NULL;
+    }
+
+    std::any visitClassStmt(Class* s) {
+        state.define(s->name.lexeme, T_ANY);
+        for (Func* m : s->methods) {
+            queue("method " + s->name.lexeme + "." + m->name.lexeme, m);
+        }
+        return NULL;
+    }
+};
+
+namespace huff {
+    //Infers types over a parsed program and specialises what it can, before it is run
+    inline std::vector<TypeRegion> inferTypes(std::vector<Stmt*>& stmts) {
+        return TypeInference(stmts).regions;
+    }
+
+    //Prints what inference found, ie: "loop line 4: 6/6 ops unchecked - i int, total double"
+    inline void dumpTypes(const std::vector<TypeRegion>& regions, std::ostream& out) {
+        for (const TypeRegion& r : regions) {
+            out << r.name << " line " << r.line << ": " << r.unchecked << "/" << r.unchecked + r.checked << " ops unchecked";
+            const char* sep = " - ";
+            for (auto& var : r.vars) {
+                static const char* names[] = {" int", " double", " num", " any"};
+                out << sep << var.first << names[var.second];
+                sep = ", ";
+            }
+            out << "\n";
+        }
+    }
+}
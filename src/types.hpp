@@ -4,10 +4,10 @@
 enum TokenType {
 	FALSE, TRUE, NUL, PLUS,MINUS,EQUAL,LEFT_BR,RIGHT_BR,LEFT_SQ,RIGHT_SQ,LEFT_CURL,RIGHT_CURL,SLASH,STAR,AT,DOT,COMMA,GREATER,LESS,EXL,
 	IS_EQUAL,ISN_EQUAL,GR_EQUAL,LE_EQUAL, UDV, SEMI_COL,
-	IF, ELSE, ELF, FOR, WHILE, SWITCH, INTEGER, STRING, IDENTIFIER, FUNC, CLASS, AND, OR, NOT, PRINT, RETURN, ARR, EF
+	IF, ELSE, ELF, FOR, WHILE, SWITCH, INTEGER, STRING, IDENTIFIER, FUNC, CLASS, AND, OR, NOT, PRINT, RETURN, ARR, THIS, COLON, IMPORT, EF
 };
 
-std::string convert[45] = {
+inline std::string convert[47] = {
 	"FALSE", "TRUE", "NUL","PLUS","MINUS","EQUAL","LEFT_BR","RIGHT_BR","LEFT_SQ","RIGHT_SQ","LEFT_CURL","RIGHT_CURL","SLASH","STAR","AT","DOT","COMMA","GREATER","LESS","EXL","IS_EQUAL","ISN_EQUAL","GR_EQUAL","LE_EQUAL",
-	"UDV","SEMI_COL", "IF","ELSE","ELF","FOR","WHILE","SWITCH","INTEGER","STRING","IDENTIFIER","FUNC","CLASS","AND", "OR", "NOT","PRINT","RETURN","ARR", "EF"
+	"UDV","SEMI_COL", "IF","ELSE","ELF","FOR","WHILE","SWITCH","INTEGER","STRING","IDENTIFIER","FUNC","CLASS","AND", "OR", "NOT","PRINT","RETURN","ARR", "THIS", "COLON", "IMPORT", "EF"
 }; 
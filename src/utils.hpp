@@ -4,28 +4,36 @@
 #include<string>
 #include<any>
 #include<stdarg.h>
+#include "hstring.hpp"
+
+//Integer values - a long long, since a plain long is what NULL (nul) is stored as
+typedef long long HInt;
 
 namespace huff {
-    std::string anyToString(std::any arg) {
+    //Number out of a value already known to hold one - no bad_any_cast to throw
+    inline double toDouble(const std::any& val) {
+        return *std::any_cast<double>(&val);
+    }
+
+    inline HInt toInt(const std::any& val) {
+        return *std::any_cast<HInt>(&val);
+    }
+
+    inline std::string anyToString(const std::any& arg) {
         if (!arg.has_value()) {
             return "";
         }
-        try {
-            return std::any_cast<std::string>(arg);
-        } catch (std::bad_any_cast err) {
-            try {
-                return std::to_string(std::any_cast<int>(arg));
-            } catch (std::bad_any_cast err) {
-                try {
-                    return std::to_string(std::any_cast<double>(arg));
-                } catch (std::bad_any_cast err) {
-                    try {
-                        return std::to_string(std::any_cast<bool>(arg))=="1" ? "true" : "false";
-                    } catch (std::bad_any_cast err){
-                        return "";
-                    }
-                }
-            }
+        if (const HString* str = std::any_cast<HString>(&arg)) {
+            return str->str();
+        } else if (const HInt* i = std::any_cast<HInt>(&arg)) {
+            return std::to_string(*i);
+        } else if (const int* i = std::any_cast<int>(&arg)) {
+            return std::to_string(*i);
+        } else if (const double* d = std::any_cast<double>(&arg)) {
+            return std::to_string(*d);
+        } else if (const bool* b = std::any_cast<bool>(&arg)) {
+            return *b ? "true" : "false";
         }
+        return "";
     }
-}
\ No newline at end of file
+}
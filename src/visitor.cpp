@@ -0,0 +1,542 @@
+#include "visitor.hpp"
+
+void Heap::markValue(const std::any& val) {
+    mark(objectOf(val));
+}
+
+GcObject* Heap::objectOf(const std::any& val) {
+    const std::type_info& t = val.type();
+    if (t == typeid(HCallable*)) return std::any_cast<HCallable*>(val);
+    if (t == typeid(Instance*)) return std::any_cast<Instance*>(val);
+    if (t == typeid(Dict*)) return std::any_cast<Dict*>(val);
+    if (t == typeid(HFile*)) return std::any_cast<HFile*>(val);
+    if (t == typeid(Future*)) return std::any_cast<Future*>(val);
+    if (t == typeid(Module*)) return std::any_cast<Module*>(val);
+    if (t == typeid(JsonDoc*)) return std::any_cast<JsonDoc*>(val);
+    return nullptr;
+}
+
+void addGlobal(Enviroment& env, std::string name, HCallable* callable) {
+    env.define(name, callable);
+}
+
+void addGlobal(Enviroment& env, Token name, HCallable* callable) {
+    env.define(name, callable);
+}
+
+
+
+
+Interpreter::Interpreter() {
+    env = nullptr;
+    global = nullptr;
+    heap.roots = this;
+
+    env = heap.make<Enviroment>(false);
+    global = env;
+
+    addGlobal(*global, "in", heap.make<in>());
+    addGlobal(*global, "type", heap.make<type>());
+    addGlobal(*global, "toNum", heap.make<toNum>());
+    addGlobal(*global, "toStr", heap.make<toStr>());
+    addGlobal(*global, "len", heap.make<length>());
+    addGlobal(*global, "contains", heap.make<contains>());
+    addGlobal(*global, "leave", heap.make<leave>());
+    addGlobal(*global, "indexOf", heap.make<indexOf>());
+    addGlobal(*global, "count", heap.make<count>());
+    addGlobal(*global, "replace", heap.make<replace>());
+    addGlobal(*global, "split", heap.make<split>());
+    addGlobal(*global, "open", heap.make<fileOpen>());
+    addGlobal(*global, "readLine", heap.make<fileReadLine>());
+    addGlobal(*global, "readAll", heap.make<fileReadAll>());
+    addGlobal(*global, "eof", heap.make<fileEof>());
+    addGlobal(*global, "write", heap.make<fileWrite>());
+    addGlobal(*global, "close", heap.make<fileClose>());
+    addGlobal(*global, "jsonParse", heap.make<jsonParse>());
+    addGlobal(*global, "jsonGet", heap.make<jsonGet>());
+    addGlobal(*global, "jsonCount", heap.make<jsonCount>());
+    addGlobal(*global, "clock", heap.make<clockNs>());
+    addGlobal(*global, "bench", heap.make<benchCalls>());
+    addGlobal(*global, "dictGet", heap.make<dictGet>());
+    addGlobal(*global, "dictSet", heap.make<dictSet>());
+    addGlobal(*global, "dictHas", heap.make<dictHas>());
+    addGlobal(*global, "dictDelete", heap.make<dictDelete>());
+    addGlobal(*global, "dictSize", heap.make<dictSize>());
+    addGlobal(*global, "dictEach", heap.make<dictEach>());
+    addGlobal(*global, "spawn", heap.make<spawnTask>());
+    addGlobal(*global, "await", heap.make<awaitTask>());
+    addGlobal(*global, "pfor", heap.make<pfor>());
+    addGlobal(*global, "preduce", heap.make<preduce>());
+}
+
+//Statement Interpretation
+std::any Interpreter::visitPrintStmt(Print* stmt) {
+    HUFF_COUNT_NODE(N_PRINT);
+    std::any val = stmt->expression->accept(this);
+    if (val.type() == typeid(HString)) {
+        //Written straight from the buffer, no copy
+        std::cout << std::any_cast<HString&>(val) << "\n";
+    } else {
+        std::cout << huff::anyToString(val) << "\n";
+    }
+    return NULL;
+}
+
+std::any Interpreter::visitVarStmt(Var* stmt) {
+    HUFF_COUNT_NODE(N_VAR);
+    //Store variable in eviroment map
+    env->define(stmt->name, stmt->initialiser->accept(this));
+    return NULL;
+}
+
+std::any Interpreter::visitBlockStmt(Block* stmt) {
+    HUFF_COUNT_NODE(N_BLOCK);
+    Enviroment* blockEnv = heap.make<Enviroment>(this->env->isFunc, env);
+    executeBlock(stmt, blockEnv);
+    return NULL;
+}
+
+std::any Interpreter::visitConditionalStmt(Conditional* stmt) {
+    HUFF_COUNT_NODE(N_CONDITIONAL);
+    if (isTruthy(stmt->condition->accept(this))) {
+        stmt->thenBranch->accept(this);
+    } else {
+        for (Conditional* elfBranch : stmt->elfs) {
+            if (returning) return NULL;
+            if (isTruthy(elfBranch->condition->accept(this))) {
+                elfBranch->thenBranch->accept(this);
+            } else if (elfBranch->elseBranch != nullptr) {
+                elfBranch->elseBranch->accept(this);
+            }
+        }
+
+        if (stmt->elseBranch != nullptr && !returning) {
+            stmt->elseBranch->accept(this);
+        }
+    } 
+
+    return NULL;
+}
+
+std::any Interpreter::visitCWhileStmt(CWhile* stmt) {
+    HUFF_COUNT_NODE(N_WHILE);
+    while (isTruthy(stmt->condition->accept(this))){
+        step();
+        stmt->body->accept(this);
+        if (returning) break;
+    }
+
+    return NULL;
+}
+
+std::any Interpreter::visitFunctionStmt(Func* stmt) {
+    HUFF_COUNT_NODE(N_FUNCTION);
+    env->define(stmt->name, (HCallable*)closure(stmt));
+    return NULL;
+}
+
+//The module isn't read until one of its names is used
+std::any Interpreter::visitImportStmt(Import* stmt) {
+    HUFF_COUNT_NODE(N_IMPORT);
+    env->define(stmt->name, heap.make<Module>(stmt->file, stmt->name.lexeme));
+    huff::prefetchModule(stmt->file);
+    return NULL;
+}
+
+std::any Interpreter::visitClassStmt(Class* stmt) {
+    HUFF_COUNT_NODE(N_CLASS);
+    HClass* klass = heap.make<HClass>(stmt);
+    RootScope scope(heap);
+    heap.pushRoot(klass);
+
+    for (Func* method : stmt->methods) {
+        klass->methods[method->name.lexeme] = closure(method);
+    }
+
+    env->define(stmt->name, (HCallable*)klass);
+    return NULL;
+}
+
+std::any Interpreter::visitExpressionStmt(Expression* stmt) {
+    HUFF_COUNT_NODE(N_EXPRESSION);
+    stmt->expression->accept(this);
+    return NULL;
+}
+
+std::any Interpreter::visitReturnStmt(Return* stmt) {
+    HUFF_COUNT_NODE(N_RETURN);
+    if (env->isFunc) {
+        //Blocks & loops stop when they see the flag, the call picks up the value
+        returnValue = stmt->returnVal->accept(this);
+        returning = true;
+        return NULL;
+    } else {
+        throw new RuntimeError("Invalid use of return statement from outside function scope", 0);
+    }
+}
+
+//Expression Interpretation
+std::any Interpreter:: visitLiteralExpr(Literal* expr) {
+    HUFF_COUNT_NODE(N_LITERAL);
+    return expr->value;
+}
+
+std::any Interpreter::visitGroupingExpr(Grouping* expr) {
+    HUFF_COUNT_NODE(N_GROUPING);
+    return expr->value->accept(this);
+}
+
+std::any Interpreter::visitUnaryExpr(Unary* expr) {
+    HUFF_COUNT_NODE(N_UNARY);
+    std::any right = expr->right->accept(this);
+    switch(expr->op.type) {
+        case MINUS:
+            if (right.type() == typeid(HInt)) {
+                return huff::negate(huff::toInt(right), expr->op.line);
+            }
+            castValid<double>(right);
+            return -huff::toDouble(right);
+        case EXL:
+            return !isTruthy(right);  
+    }
+
+    return right;
+}
+
+std::any Interpreter::visitCallableExpr(Call* expr) {
+    HUFF_COUNT_NODE(N_CALL);
+    RootScope scope(heap);
+    std::any callee = expr->callee->accept(this);
+    heap.pushRoot(&callee);
+
+    //Reserved up front so the rooted addresses stay valid
+    std::vector<std::any> args;
+    args.reserve(expr->args.size());
+    for (auto arg: expr->args) {
+        args.push_back(arg->accept(this));
+        heap.pushRoot(&args.back());
+    }
+
+    try {
+        HCallable* func = std::any_cast<HCallable*>(callee);
+        if (func->native) {
+            HUFF_COUNT(nativeCalls);
+        }
+        return func->call(this,args);
+    } catch (std::bad_any_cast e) {
+        throw(new RuntimeError("Illegal use of call operater on non-callable", expr->paren.line));
+    } catch (std::bad_variant_access e) {
+        throw (new RuntimeError("Illegal use of call operator on non-callable identifier", expr->paren.line));
+    }
+    
+}
+
+std::any Interpreter::visitBinaryExpr(Binary* expr) {
+    HUFF_COUNT_NODE(N_BINARY);
+    RootScope scope(heap);
+    std::any right = expr->right->accept(this);
+    heap.pushRoot(&right);
+    std::any left = expr->left->accept(this);
+    switch (expr->op.type) {            
+        case AND:
+            return isTruthy(right) && isTruthy(left);
+        case OR:
+            return isTruthy(right) || isTruthy(left);
+        case PLUS:
+            if (left.type() == typeid(HString) && right.type() == typeid(HString)) {
+                const HString& l = std::any_cast<HString&>(left);
+                const HString& r = std::any_cast<HString&>(right);
+                heap.reserveStrings(HString::growth(l, r));
+                return HString::concat(l, r, heap.strings);
+            } else if (!huff::isNumber(left) || !huff::isNumber(right)) {
+                throw new CastError(0, "", "addition of invalid types");
+            }
+            return huff::arithmetic(PLUS, left, right, expr->op.line);
+        case MINUS:
+        case SLASH:
+        case STAR:
+        case LESS:
+        case GREATER:
+        case GR_EQUAL:
+        case LE_EQUAL:
+            numberValid(left, right);
+            return huff::arithmetic(expr->op.type, left, right, expr->op.line);
+        case IS_EQUAL:
+            return huff::equal(left, right);
+        case ISN_EQUAL:
+            return !huff::equal(left, right);
+    }
+
+    return NULL;
+}
+
+//Operands were proved to be numbers by type inference, so there's nothing to check
+//(and nothing to root - numbers aren't collected)
+std::any Interpreter::visitNumBinaryExpr(NumBinary* expr) {
+    HUFF_COUNT_NODE(N_NUM_BINARY);
+    std::any right = expr->right->accept(this);
+    std::any left = expr->left->accept(this);
+    if (expr->leftKind == K_INT && expr->rightKind == K_INT) {
+        return huff::intArithmetic(expr->op.type, huff::toInt(left), huff::toInt(right), expr->op.line);
+    } else if (expr->leftKind == K_EITHER || expr->rightKind == K_EITHER) {
+        //Numbers, but which kind is only known now
+        return huff::arithmetic(expr->op.type, left, right, expr->op.line);
+    }
+    double a = expr->leftKind == K_INT ? (double)huff::toInt(left) : huff::toDouble(left);
+    double b = expr->rightKind == K_INT ? (double)huff::toInt(right) : huff::toDouble(right);
+    return huff::doubleArithmetic(expr->op.type, a, b, expr->op.line);
+}
+
+std::any Interpreter::visitNumUnaryExpr(NumUnary* expr) {
+    HUFF_COUNT_NODE(N_NUM_UNARY);
+    std::any right = expr->right->accept(this);
+    if (expr->kind == K_DOUBLE) {
+        return -huff::toDouble(right);
+    } else if (expr->kind == K_INT || right.type() == typeid(HInt)) {
+        return huff::negate(huff::toInt(right), expr->op.line);
+    }
+    return -huff::toDouble(right);
+}
+
+std::any Interpreter::visitGetExpr(Get* expr) {
+    HUFF_COUNT_NODE(N_GET);
+    std::any object = expr->object->accept(this);
+    Instance** found = std::any_cast<Instance*>(&object);
+    if (found == nullptr) {
+        if (Module** module = std::any_cast<Module*>(&object)) {
+            return huff::moduleGet(this, *module, expr->name);
+        }
+        throw new RuntimeError("Only class instances have properties", expr->name.line);
+    }
+    Instance* instance = *found;
+
+    //Inline cache hit - same layout as the last instance read here
+    uint64_t cached = expr->cache.load(std::memory_order_relaxed);
+    if ((cached >> 16) == instance->shape->id) {
+        return instance->slots[cached & 0xFFFF];
+    }
+
+    int slot = instance->shape->slotOf(expr->name.lexeme);
+    if (slot != -1) {
+        if (slot <= 0xFFFF) {
+            expr->cache.store(instance->shape->id << 16 | slot, std::memory_order_relaxed);
+        }
+        return instance->slots[slot];
+    }
+
+    UDCallable* method = instance->klass->findMethod(expr->name.lexeme);
+    if (method != nullptr) {
+        RootScope scope(heap);
+        heap.pushRoot(&object);
+        return (HCallable*)heap.make<BoundMethod>(method, instance);
+    }
+
+    throw new RuntimeError("Undefined property: " + expr->name.lexeme, expr->name.line);
+}
+
+std::any Interpreter::visitSetExpr(Set* expr) {
+    HUFF_COUNT_NODE(N_SET);
+    RootScope scope(heap);
+    std::any object = expr->object->accept(this);
+    heap.pushRoot(&object);
+    std::any val = expr->value->accept(this);
+
+    Instance** found = std::any_cast<Instance*>(&object);
+    if (found == nullptr) {
+        if (object.type() == typeid(Module*)) {
+            throw new RuntimeError("Can't assign to a module's globals", expr->name.line);
+        }
+        throw new RuntimeError("Only class instances have fields", expr->name.line);
+    }
+    Instance* instance = *found;
+    mutating(instance, "field " + expr->name.lexeme, expr->name.line);
+
+    //Inline cache hit - either an existing slot or the same field addition as last time
+    uint64_t cached = expr->cache.load(std::memory_order_relaxed);
+    if ((cached >> 17) == instance->shape->id) {
+        if (cached & 0x10000) {
+            instance->shape = instance->shape->with(expr->name.lexeme);
+            instance->slots.push_back(val);
+            instance->owner->charge(instance, sizeof(std::any));
+        } else {
+            instance->slots[cached & 0xFFFF] = val;
+        }
+        return val;
+    }
+
+    Shape* from = instance->shape;
+    int slot = from->slotOf(expr->name.lexeme);
+    bool added = slot == -1;
+    if (!added) {
+        instance->slots[slot] = val;
+    } else {
+        //New field - move to the shared shape with this field appended
+        instance->shape = from->with(expr->name.lexeme);
+        instance->slots.push_back(val);
+        instance->owner->charge(instance, sizeof(std::any));
+        slot = instance->slots.size() - 1;
+
+        if (instance->klass->expectedSlots < instance->slots.size()) {
+            instance->klass->expectedSlots = instance->slots.size();
+        }
+    }
+    if (slot <= 0xFFFF) {
+        expr->cache.store(from->id << 17 | (uint64_t)added << 16 | slot, std::memory_order_relaxed);
+    }
+
+    return val;
+}
+
+std::any Interpreter::visitThisExpr(This* expr) {
+    HUFF_COUNT_NODE(N_THIS);
+    if (expr->upvalue >= 0) return *upvalue(expr->upvalue);
+    return env->pull(expr->keyword);
+}
+
+std::any Interpreter::visitDictExpr(DictLiteral* expr) {
+    HUFF_COUNT_NODE(N_DICT);
+    Dict* dict = heap.make<Dict>();
+    RootScope scope(heap);
+    heap.pushRoot(dict);
+
+    for (int x = 0; x < expr->keys.size(); x++) {
+        DictKey key = huff::toKey(expr->keys[x]->accept(this), expr->brace.line);
+        dict->set(key, expr->values[x]->accept(this));
+    }
+
+    return dict;
+}
+
+std::any Interpreter::visitAssignmentExpr(Assignment* expr) {
+    HUFF_COUNT_NODE(N_ASSIGNMENT);
+    std::any val = expr->expression->accept(this);
+    if (expr->upvalue >= 0) {
+        if (worker) {
+            mutating(calls.back()->upvalues[expr->upvalue], "variable " + expr->name.lexeme, expr->name.line);
+        }
+        std::any* slot = upvalue(expr->upvalue);
+        if (!slot->has_value()) throw new RuntimeError("Failed to find variable: " + expr->name.lexeme, expr->name.line);
+        *slot = val;
+    } else {
+        if (worker) {
+            Enviroment* at = env->holder(expr->name.lexeme);
+            if (at != nullptr) mutating(at, "variable " + expr->name.lexeme, expr->name.line);
+        }
+        env->assign(expr->name, val);
+    }
+    return val;
+}
+
+std::any Interpreter::visitVariableExpr(Variable* var) {
+    HUFF_COUNT_NODE(N_VARIABLE);
+    if (var->upvalue >= 0) {
+        std::any* val = upvalue(var->upvalue);
+        if (!val->has_value()) throw new RuntimeError("Failed to find variable: " + var->name.lexeme, var->name.line);
+        return *val;
+    }
+    //Return map value for var token name (LEX)
+    return env->pull(var->name);
+}
+
+std::any* Interpreter::upvalue(int index) {
+    return calls.back()->upvalues[index]->location;
+}
+
+UDCallable* Interpreter::closure(Func* decl) {
+    //Globals are those of the function being run, which needn't be this interpreter's (parallel workers)
+    UDCallable* fn = heap.make<UDCallable>(decl, calls.empty() ? global : calls.back()->globals);
+    RootScope scope(heap);
+    heap.pushRoot(fn);
+
+    fn->upvalues.reserve(decl->captures.size());
+    for (const Capture& c : decl->captures) {
+        if (!c.local) {
+            fn->upvalues.push_back(calls.back()->upvalues[c.index]);
+            continue;
+        }
+        Enviroment* at = env;
+        for (int h = 0; h < c.hops; h++) {
+            at = at->enclosing;
+        }
+        fn->upvalues.push_back(at->capture(heap, c.forward ? at->reserve(c.name) : at->slot(c.name)));
+    }
+    return fn;
+}
+
+bool Interpreter::isTruthy(std::any expr) {
+    if (expr.has_value()){
+        if (expr.type() == typeid(bool)){
+            return any_cast<bool>(expr);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+std::any Interpreter::executeBlock(Block* block, Enviroment* blockEnv) {
+    Enviroment* prev = env;
+    frames.push_back(prev);
+    env = blockEnv;
+
+    try {
+        for (auto e: block->statements){
+            step();
+            e->accept(this);
+            if (returning) break;
+        }
+    } catch (...) {
+        //Errors unwind through here - restore the callers scope
+        if (blockEnv->open != nullptr) blockEnv->closeUpvalues();
+        env = prev;
+        frames.pop_back();
+        throw;
+    }
+    if (blockEnv->open != nullptr) blockEnv->closeUpvalues();
+    env = prev;
+    frames.pop_back();
+    //blockEnv is reclaimed by the collector once nothing references it (closures only hold upvalues)
+
+    return std::any();
+}
+
+void Interpreter::interpret(std::vector<Stmt*> stmts) {
+    try {
+        startBudget();
+        for (auto AST: stmts){
+            step();
+            AST->accept(this);
+        }
+    } catch (Err* error) {
+        error->msg();
+        delete error;
+    }
+}
+
+void Interpreter::startBudget() {
+    heap.setLimit(budget.limits.maxHeap);
+    budget.start();
+}
+
+//Only runs every Budget::CHECK_EVERY statements (when any limit is set) - also a safe point to
+//look at the heap, as statements hold no values the collector can't see
+void Interpreter::budgetCheck() {
+    budget.check();
+    if (heap.limit != 0 && heap.bytes() > heap.limit) {
+        heap.collect();
+        heap.checkLimit();
+    }
+}
+
+void Interpreter::markRoots(Heap& heap) {
+    heap.markValue(returnValue);
+    heap.mark(env);
+    heap.mark(global);
+    for (Enviroment* frame : frames) {
+        heap.mark(frame);
+    }
+    for (UDCallable* fn : calls) {
+        heap.mark(fn);
+    }
+}
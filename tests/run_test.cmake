@@ -0,0 +1,38 @@
+# Runs one Huffle script and compares its output with the matching .expected file
+# Usage: cmake -DHUFFLE=<binary> -DSCRIPT=<file.huff> [-DARGS=<flags>] [-DIMAGE=<file>] -P run_test.cmake
+# With IMAGE the script is saved to a startup image after its setup, then run from the image -
+# the two runs' output together must match
+
+string(REPLACE ".huff" ".expected" EXPECTED "${SCRIPT}")
+separate_arguments(ARGS)
+
+if(IMAGE)
+    execute_process(
+        COMMAND ${HUFFLE} ${ARGS} --snapshot=${IMAGE} ${SCRIPT}
+        OUTPUT_VARIABLE setup
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Saving ${SCRIPT} to ${IMAGE} exited with ${result}")
+    endif()
+    execute_process(
+        COMMAND ${HUFFLE} ${ARGS} --from-snapshot=${IMAGE}
+        OUTPUT_VARIABLE actual
+        RESULT_VARIABLE result
+    )
+    set(actual "${setup}${actual}")
+else()
+    execute_process(
+        COMMAND ${HUFFLE} ${ARGS} ${SCRIPT}
+        OUTPUT_VARIABLE actual
+        RESULT_VARIABLE result
+    )
+endif()
+file(READ ${EXPECTED} expected)
+
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${SCRIPT} exited with ${result}")
+endif()
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "Output of ${SCRIPT} differs from ${EXPECTED}:\n${actual}")
+endif()